@@ -0,0 +1,307 @@
+// Headless benchmark of RigidSolver: builds a scenario without any window or GL context,
+// steps it and prints the timings as JSON on stdout.
+//
+//   physics_bench [--scenario pyramid|rain|drop|hulls|ramp] [--size N] [--steps K] [--dt s]
+//                 [--broadphase brute|hash|tree|sap] [--solver pgs|tgs] [--parallel serial|islands|coloring]
+//                 [--threads T] [--no-sleep] [--csv file] [--load-state file] [--save-state file]
+//
+// pyramid: square pyramid of boxes with a base of N x N
+// rain:    N spheres falling on the floor from random heights
+// drop:    a big sphere dropped onto four stacks of N boxes
+// hulls:   N pebbles (convex hulls of a squashed icosphere) dropped in a heap
+// ramp:    N boxes, spheres and pebbles sliding down a tilted static mesh of 2048 triangles
+//
+// --csv writes every step's stats to a file; it needs a build configured with -DPHYSICS_PROFILING=ON,
+// which also fills in the narrow-phase test counts.
+//
+// --save-state writes the solver state after the last step, and --load-state restores one before the
+// first step: with the same scenario and size, a settled scene can be stepped again without its
+// settling phase, and two builds can run the exact same step sequence. "stateHash" identifies the
+// final state, to check that a replay ended where the previous one did.
+
+#include "object.h"
+#include "rigidsolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+struct BenchOptions {
+    std::string scenario = "pyramid";
+    int size = 10;
+    int steps = 1000;
+    float dt = 1.0f / 120.0f;
+    std::string broadPhase = "tree";
+    std::string solver = "pgs";
+    std::string parallel = "islands";
+    int threads = 0;        // 0 keeps the OpenMP default
+    bool sleeping = true;
+    std::string csvPath;    // Empty for no per-step dump
+    std::string loadStatePath, saveStatePath;
+};
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-sleep") { options.sleeping = false; continue; }
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        if (arg == "--scenario") options.scenario = value;
+        else if (arg == "--size") options.size = std::atoi(value);
+        else if (arg == "--steps") options.steps = std::atoi(value);
+        else if (arg == "--dt") options.dt = (float)std::atof(value);
+        else if (arg == "--broadphase") options.broadPhase = value;
+        else if (arg == "--solver") options.solver = value;
+        else if (arg == "--parallel") options.parallel = value;
+        else if (arg == "--threads") options.threads = std::atoi(value);
+        else if (arg == "--csv") options.csvPath = value;
+        else if (arg == "--load-state") options.loadStatePath = value;
+        else if (arg == "--save-state") options.saveStatePath = value;
+        else return false;
+    }
+    return options.size > 0 && options.steps > 0 && options.dt > 0.0f;
+}
+
+static bool configureSolver(const BenchOptions& options, RigidSolver& solver) {
+    if (options.broadPhase == "brute") solver.broadPhase = BroadPhaseMode::BruteForce;
+    else if (options.broadPhase == "hash") solver.broadPhase = BroadPhaseMode::SpatialHash;
+    else if (options.broadPhase == "tree") solver.broadPhase = BroadPhaseMode::AABBTree;
+    else if (options.broadPhase == "sap") solver.broadPhase = BroadPhaseMode::SweepAndPrune;
+    else return false;
+
+    if (options.solver == "pgs") solver.solverMode = SolverMode::PGS;
+    else if (options.solver == "tgs") solver.solverMode = SolverMode::TGS;
+    else return false;
+
+    if (options.parallel == "serial") solver.parallelSolve = ParallelSolve::Serial;
+    else if (options.parallel == "islands") solver.parallelSolve = ParallelSolve::Islands;
+    else if (options.parallel == "coloring") solver.parallelSolve = ParallelSolve::GraphColoring;
+    else return false;
+
+    solver.allowSleeping = options.sleeping;
+    return true;
+}
+
+// Same floor as the scenes
+const float groundLevel = -2.0f;
+
+static Object* addBox(std::vector<Object*>& objects, Mesh* mesh, Material* material, const glm::vec3& position) {
+    Object* box = new Object(mesh, material);
+    box->setPosition(position);
+    box->setAsBox(1.0f, 1.0f, 1.0f, 1.0f);
+    box->restitution = 0.0f;
+    objects.push_back(box);
+    return box;
+}
+
+static Object* addSphere(std::vector<Object*>& objects, Mesh* mesh, Material* material, const glm::vec3& position, float radius, float density) {
+    Object* sphere = new Object(mesh, material);
+    sphere->setPosition(position);
+    sphere->setScale(glm::vec3(radius));
+    sphere->setAsSphere(radius, density);
+    objects.push_back(sphere);
+    return sphere;
+}
+
+static Object* addPebble(std::vector<Object*>& objects, Mesh* mesh, Material* material, const glm::vec3& position, const glm::vec3& size) {
+    Object* pebble = new Object(mesh, material);
+    pebble->setPosition(position);
+    pebble->setScale(size);
+    pebble->setAsConvexHull(2.0f);
+    objects.push_back(pebble);
+    return pebble;
+}
+
+static bool buildScenario(const BenchOptions& options, Mesh* boxMesh, Mesh* sphereMesh, Material* material, std::vector<Object*>& objects, RigidSolver& solver) {
+    int n = options.size;
+    if (options.scenario == "pyramid") {
+        for (int y = 0; y < n; ++y) {
+            int side = n - y;
+            for (int x = 0; x < side; ++x) {
+                for (int z = 0; z < side; ++z) {
+                    addBox(objects, boxMesh, material, glm::vec3(x - (side - 1) * 0.5f, groundLevel + 0.5f + y, z - (side - 1) * 0.5f));
+                }
+            }
+        }
+    } else if (options.scenario == "rain") {
+        // Fixed seed, so every run drops the same spheres; the area grows with the count
+        std::srand(1);
+        float extent = std::max(5.0f, std::sqrt((float)n));
+        auto random = [](float lo, float hi) { return lo + (hi - lo) * (std::rand() / (float)RAND_MAX); };
+        for (int i = 0; i < n; ++i) {
+            glm::vec3 position(random(-extent, extent), groundLevel + random(1.0f, 20.0f), random(-extent, extent));
+            addSphere(objects, sphereMesh, material, position, 0.25f, 2.0f);
+        }
+    } else if (options.scenario == "drop") {
+        for (int stack = 0; stack < 4; ++stack) {
+            float x = (stack % 2) * 1.5f - 0.75f, z = (stack / 2) * 1.5f - 0.75f;
+            for (int y = 0; y < n; ++y) addBox(objects, boxMesh, material, glm::vec3(x, groundLevel + 0.5f + y, z));
+        }
+        Object* ball = addSphere(objects, sphereMesh, material, glm::vec3(0.0f, groundLevel + n + 3.0f, 0.0f), 1.0f, 5.0f);
+        ball->velocity = glm::vec3(0.0f, -5.0f, 0.0f);
+    } else if (options.scenario == "hulls") {
+        // Layers of 5 x 5 pebbles with random sizes and orientations
+        std::srand(1);
+        auto random = [](float lo, float hi) { return lo + (hi - lo) * (std::rand() / (float)RAND_MAX); };
+        for (int i = 0; i < n; ++i) {
+            int layer = i / 25, cell = i % 25;
+            glm::vec3 position((cell % 5 - 2) * 0.8f, groundLevel + 0.5f + layer * 0.7f, (cell / 5 - 2) * 0.8f);
+            Object* pebble = addPebble(objects, sphereMesh, material, position, glm::vec3(random(0.2f, 0.35f), random(0.12f, 0.25f), random(0.2f, 0.35f)));
+            pebble->setRotation(glm::vec3(random(0.0f, 360.0f), random(0.0f, 360.0f), random(0.0f, 360.0f)));
+        }
+    } else if (options.scenario == "ramp") {
+        // 20 x 20 plane split into 2048 triangles, tilted by 20 degrees and raised above the floor
+        Mesh ramp({}, {});
+        ramp.addPlan(10.0f);
+        for (int i = 0; i < 5; ++i) ramp.subdivideLinear();
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, groundLevel + 4.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(20.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        solver.addStaticMesh(ramp, model);
+
+        std::srand(1);
+        auto random = [](float lo, float hi) { return lo + (hi - lo) * (std::rand() / (float)RAND_MAX); };
+        for (int i = 0; i < n; ++i) {
+            int row = i / 10, cell = i % 10;
+            glm::vec3 position(4.0f + (row % 4) * 1.2f, groundLevel + 7.0f + (row / 4) * 1.5f, (cell - 4.5f) * 1.5f);
+            if (i % 3 == 0) {
+                addBox(objects, boxMesh, material, position);
+            } else if (i % 3 == 1) {
+                addSphere(objects, sphereMesh, material, position, 0.4f, 2.0f);
+            } else {
+                addPebble(objects, sphereMesh, material, position, glm::vec3(random(0.25f, 0.4f), random(0.15f, 0.3f), random(0.25f, 0.4f)));
+            }
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    RigidSolver solver(glm::vec3(0.0f, -9.81f, 0.0f), groundLevel);
+    if (!parseOptions(argc, argv, options) || !configureSolver(options, solver)) {
+        std::fprintf(stderr, "usage: physics_bench [--scenario pyramid|rain|drop|hulls|ramp] [--size N] [--steps K] [--dt s]\n"
+                             "                     [--broadphase brute|hash|tree|sap] [--solver pgs|tgs]\n"
+                             "                     [--parallel serial|islands|coloring] [--threads T] [--no-sleep]\n"
+                             "                     [--csv file] [--load-state file] [--save-state file]\n");
+        return 1;
+    }
+    if (options.threads > 0) omp_set_num_threads(options.threads);
+
+    // No GL context here: the meshes only hold their vertices
+    Mesh::uploadToGPU = false;
+    Mesh* boxMesh = new Mesh({}, {});
+    boxMesh->addCube(1.0f);
+    Mesh* sphereMesh = Icosahedron::createIcosphere(1.0f, 1);
+    Material* material = new Material();
+
+    std::vector<Object*> objects;
+    if (!buildScenario(options, boxMesh, sphereMesh, material, objects, solver)) {
+        std::fprintf(stderr, "physics_bench: unknown scenario '%s'\n", options.scenario.c_str());
+        return 1;
+    }
+    for (Object* obj : objects) solver.addObject(obj);
+    solver.getProfiler().setCapacity(options.steps);
+
+    SolverState state;
+    if (!options.loadStatePath.empty()) {
+        if (!state.readFile(options.loadStatePath) || !solver.restoreState(state)) {
+            std::fprintf(stderr, "physics_bench: '%s' is not a state of this scenario\n", options.loadStatePath.c_str());
+            return 1;
+        }
+    }
+
+    // Phase times are summed in a StepStats, counts in doubles to stay clear of overflow on long runs
+    StepStats total;
+    double pairs = 0.0, contacts = 0.0, iterations = 0.0;
+    double narrowTests[(int)ShapePair::Count] = {};
+    int maxContacts = 0;
+    double start = omp_get_wtime();
+    for (int i = 0; i < options.steps; ++i) {
+        solver.step(options.dt);
+        const StepStats& stats = solver.getStepStats();
+        total.integrate += stats.integrate;
+        total.broadPhase += stats.broadPhase;
+        total.narrowPhase += stats.narrowPhase;
+        total.merge += stats.merge;
+        total.preStep += stats.preStep;
+        total.solve += stats.solve;
+        total.integratePositions += stats.integratePositions;
+        total.sleep += stats.sleep;
+        for (int p = 0; p < (int)ShapePair::Count; ++p) narrowTests[p] += stats.narrowTests[p];
+        pairs += stats.pairs;
+        contacts += stats.contacts;
+        iterations += stats.iterations;
+        maxContacts = std::max(maxContacts, stats.contacts);
+    }
+    double seconds = omp_get_wtime() - start;
+    double steps = options.steps;
+
+    // [FNV-1a] Of the final state's bytes
+    solver.saveState(state);
+    unsigned long long stateHash = 14695981039346656037ull;
+    for (size_t i = 0; i < state.size(); ++i) stateHash = (stateHash ^ state.bytes()[i]) * 1099511628211ull;
+    if (!options.saveStatePath.empty() && !state.writeFile(options.saveStatePath)) {
+        std::fprintf(stderr, "physics_bench: cannot write '%s'\n", options.saveStatePath.c_str());
+    }
+
+    if (!options.csvPath.empty()) {
+        if (solver.getProfiler().size() == 0) {
+            std::fprintf(stderr, "physics_bench: no step history, rebuild with -DPHYSICS_PROFILING=ON for --csv\n");
+        } else if (!solver.getProfiler().writeCSV(options.csvPath)) {
+            std::fprintf(stderr, "physics_bench: cannot write '%s'\n", options.csvPath.c_str());
+        }
+    }
+
+    std::printf("{\n");
+    std::printf("  \"scenario\": \"%s\",\n", options.scenario.c_str());
+    std::printf("  \"size\": %d,\n", options.size);
+    std::printf("  \"bodies\": %d,\n", (int)objects.size());
+    std::printf("  \"steps\": %d,\n", options.steps);
+    std::printf("  \"dt\": %g,\n", options.dt);
+    std::printf("  \"threads\": %d,\n", omp_get_max_threads());
+    std::printf("  \"broadPhase\": \"%s\",\n", options.broadPhase.c_str());
+    std::printf("  \"solver\": \"%s\",\n", options.solver.c_str());
+    std::printf("  \"parallel\": \"%s\",\n", options.parallel.c_str());
+    std::printf("  \"sleeping\": %s,\n", options.sleeping ? "true" : "false");
+    std::printf("  \"stepsPerSecond\": %.2f,\n", steps / seconds);
+    std::printf("  \"msPerStep\": %.4f,\n", seconds * 1000.0 / steps);
+    std::printf("  \"pairsPerStep\": %.1f,\n", pairs / steps);
+    std::printf("  \"contactsPerStep\": %.1f,\n", contacts / steps);
+    std::printf("  \"maxContacts\": %d,\n", maxContacts);
+    std::printf("  \"iterationsPerStep\": %.2f,\n", iterations / steps);
+    std::printf("  \"awake\": %d,\n", solver.getAwakeCount());
+    std::printf("  \"asleep\": %d,\n", solver.getSleepingCount());
+    std::printf("  \"stateHash\": \"%016llx\",\n", stateHash);
+    std::printf("  \"phaseMsPerStep\": {\n");
+    std::printf("    \"integrate\": %.4f,\n", total.integrate / steps);
+    std::printf("    \"broadPhase\": %.4f,\n", total.broadPhase / steps);
+    std::printf("    \"narrowPhase\": %.4f,\n", total.narrowPhase / steps);
+    std::printf("    \"merge\": %.4f,\n", total.merge / steps);
+    std::printf("    \"preStep\": %.4f,\n", total.preStep / steps);
+    std::printf("    \"solve\": %.4f,\n", total.solve / steps);
+    std::printf("    \"integratePositions\": %.4f,\n", total.integratePositions / steps);
+    std::printf("    \"sleep\": %.4f\n", total.sleep / steps);
+    std::printf("  },\n");
+#ifdef PHYSICS_PROFILING
+    std::printf("  \"narrowTestsPerStep\": {\n");
+    for (int p = 0; p < (int)ShapePair::Count; ++p) {
+        std::printf("    \"%s\": %.1f%s\n", PhysicsProfiler::shapePairName((ShapePair)p), narrowTests[p] / steps,
+                    p + 1 < (int)ShapePair::Count ? "," : "");
+    }
+    std::printf("  },\n");
+#endif
+    std::printf("  \"profiling\": %s\n", solver.getProfiler().size() > 0 ? "true" : "false");
+    std::printf("}\n");
+
+    for (Object* obj : objects) delete obj;
+    delete boxMesh;
+    delete sphereMesh;
+    delete material;
+    return 0;
+}
@@ -0,0 +1,204 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// World-space axis-aligned bounding box
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    bool overlaps(const AABB& o) const {
+        return min.x <= o.max.x && max.x >= o.min.x &&
+               min.y <= o.max.y && max.y >= o.min.y &&
+               min.z <= o.max.z && max.z >= o.min.z;
+    }
+
+    bool contains(const AABB& o) const {
+        return min.x <= o.min.x && min.y <= o.min.y && min.z <= o.min.z &&
+               max.x >= o.max.x && max.y >= o.max.y && max.z >= o.max.z;
+    }
+
+    // Surface area heuristic cost
+    float area() const {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    static AABB merge(const AABB& a, const AABB& b) {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
+};
+
+// Candidate pair handed to the narrow phase (a < b, indices into the solver's body list)
+struct BroadPhasePair {
+    int a, b;
+    bool operator<(const BroadPhasePair& o) const { return a < o.a || (a == o.a && b < o.b); }
+};
+
+// [Spatial hashing] Uniform grid rebuilt from scratch every step.
+// Each box is inserted in every cell it touches, and a pair is only reported by the
+// cell holding the min corner of the two boxes' overlap, so no duplicates are produced.
+class SpatialHashGrid {
+public:
+    float cellSize;
+    // Boxes spanning more cells than this on one axis skip the grid and are tested against everything
+    int maxCellsPerAxis;
+
+    SpatialHashGrid(float cellSize = 2.0f, int maxCellsPerAxis = 4);
+
+    void build(const std::vector<AABB>& bounds);
+    void findPairs(const std::vector<AABB>& bounds, std::vector<BroadPhasePair>& pairs) const;
+
+private:
+    struct CellEntry {
+        uint64_t key;
+        int body;
+        bool operator<(const CellEntry& o) const { return key < o.key || (key == o.key && body < o.body); }
+    };
+
+    std::vector<CellEntry> entries;
+    std::vector<int> oversized;
+
+    glm::ivec3 cellOf(const glm::vec3& p) const;
+    static uint64_t packKey(const glm::ivec3& c);
+};
+
+// [Dynamic AABB tree] Persistent bounding volume hierarchy over fattened boxes.
+// Leaves are only reinserted when the tight box escapes its fat box, and AVL-style
+// rotations keep the tree balanced, so bodies of very different sizes cost O(log n).
+class DynamicAABBTree {
+public:
+    float fatMargin;
+
+    DynamicAABBTree(float fatMargin = 0.1f);
+
+    int createProxy(const AABB& box, int body);
+    void destroyProxy(int proxy);
+    // Returns true if the leaf had to be reinserted
+    bool moveProxy(int proxy, const AABB& box);
+    // For bodies renumbered by a swap-remove
+    void setProxyBody(int proxy, int body) { nodes[proxy].body = body; }
+
+    void findPairs(std::vector<BroadPhasePair>& pairs) const;
+
+    // Calls visit(body) for every leaf whose fat box overlaps 'box'. Does not allocate.
+    template <typename Visitor>
+    void query(const AABB& box, Visitor&& visit) const;
+
+    const AABB& getFatAABB(int proxy) const { return nodes[proxy].box; }
+    int getHeight() const { return root == -1 ? 0 : nodes[root].height; }
+
+private:
+    struct Node {
+        AABB box;
+        int parent;     // Next free node when unused
+        int child1, child2;
+        int height;     // 0 for leaves, -1 for free nodes
+        int body;
+        bool isLeaf() const { return child1 == -1; }
+    };
+
+    std::vector<Node> nodes;
+    int root;
+    int freeList;
+
+    // Per-thread query scratch, kept between steps so pair queries do not allocate
+    struct alignas(64) QueryArena {
+        std::vector<BroadPhasePair> pairs;
+        std::vector<int> stack;
+    };
+    mutable std::vector<QueryArena> queryArenas;
+    mutable std::vector<size_t> arenaOffsets;
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int a);
+};
+
+template <typename Visitor>
+void DynamicAABBTree::query(const AABB& box, Visitor&& visit) const {
+    if (root == -1) return;
+    // The balanced tree stays far below this height
+    int stack[64];
+    int top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!node.box.overlaps(box)) continue;
+        if (node.isLeaf()) {
+            visit(node.body);
+        } else {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+}
+
+// [Sweep and prune] Sorted endpoint lists on the three axes, kept across steps.
+// Bodies barely move between two steps, so insertion sort runs in close to O(n),
+// and every swap of a min and a max endpoint adds or removes one pair.
+class SweepAndPrune {
+public:
+    int createProxy(const AABB& box, int body);
+    // The proxy's pairs go away at the next update()
+    void destroyProxy(int proxy);
+    void moveProxy(int proxy, const AABB& box);
+    void setProxyBody(int proxy, int body) { proxies[proxy].body = body; }
+
+    // Re-sorts the endpoints, updating the pair set and recording pair events
+    void update();
+    void getPairs(std::vector<BroadPhasePair>& pairs) const;
+
+    // Pair events (as body indices) since the last clearPairEvents(); pairs of a destroyed
+    // proxy are removed with body -1 on its side
+    const std::vector<BroadPhasePair>& getAddedPairs() const { return addedPairs; }
+    const std::vector<BroadPhasePair>& getRemovedPairs() const { return removedPairs; }
+    void clearPairEvents() { addedPairs.clear(); removedPairs.clear(); }
+
+private:
+    struct Endpoint {
+        float value;
+        int proxy;
+        bool isMax;
+    };
+
+    struct Proxy {
+        AABB box;
+        int body;       // -1 when the proxy is free
+        int minIndex[3], maxIndex[3];
+    };
+
+    std::vector<Endpoint> axes[3];
+    std::vector<Proxy> proxies;
+    std::vector<int> freeProxies;
+    bool destroyedProxies = false;  // Since the last update, whose pairs are still listed
+
+    // Current pairs as packed proxy ids
+    std::vector<uint64_t> pairList;
+    std::vector<BroadPhasePair> addedPairs, removedPairs;
+
+    // [Open addressing] Pair key -> slot in pairList, for O(1) removal. Linear probing in a
+    // power-of-two table kept at most half full; it keeps its storage across steps, so new
+    // overlaps only allocate when the pair count reaches a new high.
+    static constexpr uint64_t emptyKey = ~0ull;
+    std::vector<uint64_t> slotKeys;     // emptyKey where unused
+    std::vector<int> slotValues;
+    int slotCount = 0;
+
+    static uint64_t pairKey(int p, int q);
+    BroadPhasePair bodyPair(uint64_t key) const;
+    int homeSlot(uint64_t key) const;
+    int findSlot(uint64_t key) const;   // Position of key, or the empty position where it would go
+    void eraseSlot(int position);
+    void growSlots();
+    void addPair(int p, int q);
+    void removePair(int p, int q);
+    void sortAxis(int axis);
+};
+
+#endif // BROADPHASE_H
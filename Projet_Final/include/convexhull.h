@@ -0,0 +1,26 @@
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Convex hull of a point cloud, in the frame of the points (a mesh's model space)
+struct ConvexHull {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::ivec3> triangles;  // Counter-clockwise seen from outside
+    std::vector<glm::vec4> planes;      // Outward unit normal and offset of each triangle: dot(n, p) = w on it
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+    float radius = 0.0f;                // Farthest vertex from the origin
+
+    // Index of the vertex farthest along dir
+    int support(const glm::vec3& dir) const;
+
+    // False for flat or degenerate point clouds, whose hull is only a vertex list without faces
+    bool hasFaces() const { return !triangles.empty(); }
+};
+
+// [Quickhull] Starts from a tetrahedron of extreme points, then repeatedly adds the point farthest
+// outside a face, replacing the faces it sees by a fan around their horizon. O(n log n) on average.
+ConvexHull buildConvexHull(const std::vector<glm::vec3>& points);
+
+#endif // CONVEXHULL_H
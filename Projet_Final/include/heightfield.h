@@ -0,0 +1,28 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <glm/glm.hpp>
+
+// [Heightfield] Regular grid of height samples read in place from the memory of their owner (an
+// animated mesh's vertices), so the owner can rewrite them every step without any rebuild. A point
+// finds the cell below it in O(1); each cell is split along the diagonal from (x + 1, z) to (x, z + 1).
+class HeightfieldCollider {
+public:
+    // Sample (x, z) is heights[(x + z * resX) * stride], at origin + (x, z) * cellSize in the xz plane
+    HeightfieldCollider(const float* heights, int stride, int resX, int resZ, const glm::vec2& origin, float cellSize);
+
+    float height(int x, int z) const { return heights[(x + z * resX) * stride]; }
+
+    // Surface height and upward unit normal above (x, z), from the triangle holding that point.
+    // False outside the grid.
+    bool sample(float x, float z, float& h, glm::vec3& normal) const;
+
+private:
+    const float* heights;
+    int stride;
+    int resX, resZ;
+    glm::vec2 origin;
+    float cellSize;
+};
+
+#endif // HEIGHTFIELD_H
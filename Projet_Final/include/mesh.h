@@ -6,6 +6,9 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
+#include <memory>
+
+struct ConvexHull;
 
 // Vertex structure containing position, normal, and texture coordinates
 struct Vertex {
@@ -20,11 +23,18 @@ public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
 
+    // When false, meshes stay on the CPU and draw() does nothing: headless tools run without a GL context
+    static bool uploadToGPU;
+
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices);
     void draw();
     void cleanup();
     virtual ~Mesh() {}
 
+    // Convex hull of the vertices, built on first use and cached until the geometry changes.
+    // Not thread-safe: colliders request it once when they are set up.
+    std::shared_ptr<const ConvexHull> getConvexHull();
+
     void computeBoundingSphere(glm::vec3 &center, float &radius) const;
     void computeAABB(glm::vec3 &min, glm::vec3 &max) const;
     void recomputeNormals();
@@ -39,6 +49,7 @@ public:
 
 private:
     unsigned int VAO, VBO, EBO;
+    std::shared_ptr<const ConvexHull> convexHull;
 protected:
     void setupMesh();
 };
@@ -0,0 +1,68 @@
+#ifndef MESHCOLLIDER_H
+#define MESHCOLLIDER_H
+
+#include "broadphase.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+
+// [BVH] Static triangle mesh baked in world space, with a bounding volume hierarchy over its
+// triangles built once. Bodies query it with their box, so the cost grows with log(triangles).
+class TriangleMeshCollider {
+public:
+    struct Triangle {
+        glm::vec3 v[3];
+        glm::vec3 normal;       // Front side, following the mesh's vertex normals whatever the winding
+        uint8_t flatEdges;      // Bit k: edge v[k] -> v[k+1] is shared with a coplanar or concave neighbor
+    };
+
+    TriangleMeshCollider(const Mesh& mesh, const glm::mat4& model);
+
+    // Calls visit(triangleIndex) for every triangle whose box overlaps 'box'. Does not allocate.
+    template <typename Visitor>
+    void query(const AABB& box, Visitor&& visit) const;
+
+    const AABB& getBounds() const { return nodes[0].box; }
+    const Triangle& getTriangle(int i) const { return triangles[i]; }
+    int getTriangleCount() const { return (int)triangles.size(); }
+
+private:
+    // Leaves hold 'count' triangles from 'first'; inner nodes have count == 0, their left child
+    // right after them and their right child at 'first'
+    struct Node {
+        AABB box;
+        int first;
+        int count;
+    };
+
+    std::vector<Triangle> triangles;
+    std::vector<Node> nodes;
+
+    int build(std::vector<int>& order, std::vector<AABB>& boxes, int begin, int end, int depth);
+    void findFlatEdges();
+};
+
+// Deep enough for a median split tree over 2^32 triangles
+const int meshColliderMaxDepth = 64;
+
+template <typename Visitor>
+void TriangleMeshCollider::query(const AABB& box, Visitor&& visit) const {
+    if (nodes.empty()) return;
+    int stack[meshColliderMaxDepth];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!node.box.overlaps(box)) continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) visit(i);
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = (int)(&node - nodes.data()) + 1;
+        }
+    }
+}
+
+#endif // MESHCOLLIDER_H
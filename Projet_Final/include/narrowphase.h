@@ -0,0 +1,100 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <glm/glm.hpp>
+
+class Object;
+struct ConvexHull;
+
+// Oriented box: world center, unit axes (columns of the rotation) and half extents
+struct OBB {
+    glm::vec3 center;
+    glm::vec3 axes[3];
+    glm::vec3 halfExtents;
+};
+
+OBB getOBB(const Object* obj);
+
+// [SIMD] Eight OBBs in structure-of-arrays layout, one lane per box
+struct OBBBatch {
+    alignas(32) float center[3][8];
+    alignas(32) float axes[3][3][8];        // axes[axis][component][lane]
+    alignas(32) float halfExtents[3][8];
+
+    void set(int lane, const OBB& obb);
+};
+
+// Separating axis test on 8 pairs (a lane i against b lane i) at once, without building contacts.
+// Returns a bit mask of the overlapping lanes. Uses AVX2 when the build targets it, scalar code otherwise.
+int overlapOBB8(const OBBBatch& a, const OBBBatch& b);
+
+// One point of a contact manifold, before it becomes a solver constraint
+struct ContactPoint {
+    glm::vec3 position;
+    float penetration;
+    int feature;    // Stable id within the pair for warm starting, -1 when matched by proximity
+};
+
+// Manifolds never hold more than this, whatever the tessellation of the meshes
+const int maxManifoldPoints = 4;
+
+// [Contact clipping] Box-box manifold. Runs SAT on the 15 axes; on a face axis the incident face
+// of the other box is clipped against the side planes of the reference face. On an edge axis the
+// closest points of the two edges give a single contact. normal points from B to A.
+// Returns the number of points written to out, 0 when the boxes are separated.
+int collideBoxBox(const OBB& a, const OBB& b, glm::vec3& normal, float& depth, ContactPoint out[maxManifoldPoints]);
+
+// Analytic box vs plane (points p with dot(normal, p) < offset are inside the plane's half-space).
+// Contacts sit on the box corners below the plane, with the corner index as feature.
+int collideBoxPlane(const OBB& box, const glm::vec3& normal, float offset, ContactPoint out[maxManifoldPoints]);
+
+// Keeps at most 4 points: the deepest, the farthest from it, and the two spanning the largest
+// area on each side of that segment
+int reduceManifold(const ContactPoint* points, int count, const glm::vec3& normal, ContactPoint out[maxManifoldPoints]);
+
+// Faces with more corners (cylinder caps) are subsampled for clipping
+const int maxFaceVertices = 16;
+
+// Convex body seen through its support mapping. A sphere is a point core rounded by its radius.
+struct ConvexShape {
+    enum Type { Sphere, Box, Hull, Triangle } type;
+    const ConvexHull* hull = nullptr;   // Model-space hull, owned by the object
+    const glm::vec3* corners = nullptr; // World-space triangle corners, owned by the mesh collider
+    glm::vec3 center;
+    glm::mat3 rotation;
+    glm::vec3 scale;                    // Hull scale, or box half extents
+    float radius = 0.0f;                // Rounding of the core: the sphere radius, 0 otherwise
+
+    // Farthest point of the core along dir, in world space
+    glm::vec3 support(const glm::vec3& dir) const;
+
+    // Corners of the core (box corners or hull vertices) in world space
+    int vertexCount() const;
+    glm::vec3 vertex(int i) const;
+
+    // Face whose outward normal is closest to dir (unit), when within cosLimit of it: its corners
+    // in world space, counter-clockwise around faceNormal. Returns the corner count, 0 without such a face.
+    int supportFace(const glm::vec3& dir, float cosLimit, glm::vec3 face[maxFaceVertices], glm::vec3& faceNormal) const;
+
+    // Farthest point of the core from the center
+    float boundingRadius() const;
+};
+
+ConvexShape getConvexShape(const Object* obj);
+ConvexShape getTriangleShape(const glm::vec3 corners[3]);
+
+// [GJK/EPA] Signed distance between two convex shapes: GJK gives the closest points while they are
+// apart, EPA the penetration depth once their cores overlap (distance < 0). normal points from B to A,
+// pointA and pointB are the witness points on the two surfaces.
+void convexDistance(const ConvexShape& A, const ConvexShape& B, glm::vec3& normal, float& distance, glm::vec3& pointA, glm::vec3& pointB);
+
+// Manifold of two convex shapes up to 'margin' apart (negative penetrations are speculative).
+// When a face of either shape lies along the GJK/EPA normal, the facing polygon of the other shape
+// is clipped against it as in collideBoxBox; rounded shapes and edge contacts give the witness point.
+int collideConvex(const ConvexShape& A, const ConvexShape& B, float margin, glm::vec3& normal, ContactPoint out[maxManifoldPoints]);
+
+// Convex shape vs plane, same convention as collideBoxPlane: the core vertices below the plane,
+// with the vertex index as feature
+int collideConvexPlane(const ConvexShape& shape, const glm::vec3& normal, float offset, ContactPoint out[maxManifoldPoints]);
+
+#endif // NARROWPHASE_H
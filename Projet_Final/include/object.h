@@ -8,6 +8,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
 #include <string>
+#include <memory>
 
 class Shader;
 
@@ -45,12 +46,27 @@ public:
     glm::quat orientation;
     glm::vec3 scale;
 
+    // Pose at the start of the last physics step, which rendering interpolates from
+    glm::vec3 previousPosition;
+    glm::quat previousOrientation;
+
     glm::vec3 velocity;
     glm::vec3 linearMomentum;
     float mass;
     float collisionRadius;
     bool fixedObject;
     bool isSphere = false;
+    bool isConvexHull = false;
+    std::shared_ptr<const ConvexHull> convexHull;   // Collision shape of hull objects, in model space (before scale)
+
+    // Sleep state, managed by the RigidSolver
+    bool sleeping = false;
+    int sleepCounter = 0;   // Consecutive steps spent below the sleep thresholds
+
+    // Slots in the Scene's and the RigidSolver's object lists (-1 outside them), for O(1) removal
+    int sceneIndex = -1;
+    int bodyIndex = -1;
+    float lifetime = -1.0f; // Seconds left before the scene recycles the object, negative for no limit
 
     glm::vec3 angularVelocity;
     glm::vec3 angularMomentum;
@@ -65,9 +81,15 @@ public:
 
     void setAsBox(float width, float height, float depth, float density);
     void setAsSphere(float radius, float density);
+    // Collides through the convex hull of the mesh; call after setScale, mass and inertia use the scaled hull
+    void setAsConvexHull(float density);
 
     void draw(Shader& shader);
+    void draw(Shader& shader, const glm::mat4& model);
     glm::mat4 getModelMatrix() const;
+    // At another pose than the current one, such as a render snapshot's
+    glm::mat4 getModelMatrix(const glm::vec3& pos, const glm::quat& rot) const;
+    // Teleports: the previous pose follows, so the move is not interpolated
     void setPosition(const glm::vec3& pos);
     void setRotation(const glm::vec3& eulerAngles);
     void setScale(const glm::vec3& s);
@@ -83,6 +105,7 @@ public:
     void resetForces();
 
     void toGPU(struct GPUObject& gpuObject, std::vector<struct GPUTriangle>& gpuTriangles, size_t triangle_offset) const;
+    void toGPU(struct GPUObject& gpuObject, std::vector<struct GPUTriangle>& gpuTriangles, size_t triangle_offset, const glm::mat4& model) const;
 
 private:
     glm::vec3 netForce;
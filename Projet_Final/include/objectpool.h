@@ -0,0 +1,28 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include "object.h"
+#include <vector>
+
+// [Object pool] Released Objects are kept and handed out again, so scenes that keep spawning and
+// culling bodies (shots) stop allocating once warmed up. Live objects belong to their scene, the
+// released ones to the pool.
+class ObjectPool {
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ~ObjectPool();
+
+    // A recycled object reset as if just constructed, or a new one
+    Object* acquire(Mesh* mesh, Material* material);
+    // The object must already be out of its scene and solver
+    void release(Object* obj);
+
+    int getFreeCount() const { return (int)freeObjects.size(); }
+
+private:
+    std::vector<Object*> freeObjects;
+};
+
+#endif // OBJECTPOOL_H
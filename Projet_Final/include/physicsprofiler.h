@@ -0,0 +1,74 @@
+#ifndef PHYSICSPROFILER_H
+#define PHYSICSPROFILER_H
+
+#include <string>
+#include <vector>
+
+// [Instrumentation] Compile-time switch, set by configuring with -DPHYSICS_PROFILING=ON.
+// Without it the per-shape counters and the step history compile to nothing; the phase
+// times of the last step are always kept, as they cost a few clock reads per step.
+#ifdef PHYSICS_PROFILING
+#define PHYSICS_PROFILE(statement) statement
+#else
+#define PHYSICS_PROFILE(statement)
+#endif
+
+// Kinds of narrow-phase test, by the shapes involved
+enum class ShapePair {
+    SphereSphere,
+    SphereBox,
+    BoxBox,
+    Convex,       // Anything involving a hull (GJK/EPA)
+    Floor,
+    StaticMesh,
+    Heightfield,
+    Count
+};
+
+// Wall-clock time (ms) of each phase of one step, and what the step worked on. Waking a sleeping
+// island runs collision detection again: the phase times, pairs and tests add up over those passes.
+struct StepStats {
+    long long step = 0;         // Steps taken by the solver before this one
+    double integrate = 0.0;     // Body sync and velocity integration, then the inertia update and write-back after the solve
+    double broadPhase = 0.0;
+    double narrowPhase = 0.0;   // Pair, floor and static collider tests
+    double merge = 0.0;         // Gathering the per-thread contact arenas into one list
+    double preStep = 0.0;       // Solver rows, warm-start recall, islands or colors
+    double solve = 0.0;         // Iterations (with the position updates for TGS sub-steps)
+    double integratePositions = 0.0;
+    double sleep = 0.0;         // Wake-ups (before and during detection) and sleep bookkeeping
+    int pairs = 0;              // Broad-phase candidate pairs, over all detection passes
+    int contacts = 0;
+    int iterations = 0;         // As getIterationsUsed()
+    int narrowTests[(int)ShapePair::Count] = {};  // Counted with PHYSICS_PROFILING only
+
+    double total() const { return integrate + broadPhase + narrowPhase + merge + preStep + solve + integratePositions + sleep; }
+};
+
+// Ring buffer of the last 'capacity' steps' stats, filled by the solver when profiling is compiled in
+class PhysicsProfiler {
+public:
+    explicit PhysicsProfiler(int capacity = 1024) : capacity(capacity) {}
+
+    // Drops the history
+    void setCapacity(int newCapacity);
+    void clear() { head = count = 0; }
+    void record(const StepStats& stats);
+
+    int size() const { return count; }
+    // 0 is the oldest step kept, size() - 1 the last one
+    const StepStats& operator[](int i) const { return ring[(head + i) % capacity]; }
+
+    // One line per step, oldest first. Returns false if the file cannot be written.
+    bool writeCSV(const std::string& path) const;
+
+    static const char* shapePairName(ShapePair pair);
+
+private:
+    std::vector<StepStats> ring;    // Allocated on the first record
+    int capacity;
+    int head = 0;                   // Oldest entry
+    int count = 0;
+};
+
+#endif // PHYSICSPROFILER_H
@@ -0,0 +1,106 @@
+#ifndef PHYSICSTHREAD_H
+#define PHYSICSTHREAD_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Scene;
+class Object;
+
+// Where an object was at the start and at the end of the last physics step
+struct BodyTransform {
+    Object* object;
+    glm::vec3 previousPosition, position;
+    glm::quat previousOrientation, orientation;
+
+    // [Interpolation] alpha = 0 is the previous pose, 1 the current one
+    glm::vec3 positionAt(float alpha) const { return glm::mix(previousPosition, position, alpha); }
+    glm::quat orientationAt(float alpha) const { return glm::slerp(previousOrientation, orientation, alpha); }
+};
+
+// Everything the render thread reads from the simulation, copied once per physics tick
+struct PhysicsSnapshot {
+    std::vector<BodyTransform> bodies;  // Every scene object, in the scene's order
+    long long stepCount = 0;            // Steps simulated so far
+    double stepMs = 0.0;                // Average wall-clock cost of the tick's steps
+    float timeScale = 1.0f;             // Simulated seconds per real second, below 1 when physics falls behind
+    int awake = 0, asleep = 0, iterations = 0;
+
+    double publishTime = 0.0;           // Steady clock seconds when the snapshot was taken
+    double accumulator = 0.0;           // Unsimulated time left over at that moment
+    float fixedTimeStep = 1.0f / 120.0f;
+
+    // How far real time has moved past the last step, in steps: the alpha to render the bodies at.
+    // The displayed state trails the simulation by up to one step in exchange for smooth motion.
+    float interpolationFactor() const;
+};
+
+// [Triple buffering] Lock-free single producer / single consumer hand-off. The writer fills its
+// back slot and swaps it with the middle one; the reader swaps the middle one with its front slot
+// when it holds something newer. Neither side ever waits, and the reader always sees a whole value.
+template <typename T>
+class TripleBuffer {
+public:
+    T& back() { return slots[backIndex]; }
+    void publish() { backIndex = middle.exchange(backIndex | freshBit) & indexMask; }
+
+    // The newest published value, or the same one again if nothing new was published
+    const T& latest() {
+        if (middle.load() & freshBit) frontIndex = middle.exchange(frontIndex) & indexMask;
+        return slots[frontIndex];
+    }
+
+private:
+    static const int freshBit = 4, indexMask = 3;
+    T slots[3];
+    int backIndex = 0, frontIndex = 1;
+    std::atomic<int> middle{2};
+};
+
+// [Physics thread] Steps a scene at a fixed rate on its own thread, so a slow frame never holds
+// back the simulation and a burst of catch-up steps never holds back a frame. Each wake-up runs
+// at most maxStepsPerTick steps; time owed beyond that is dropped and the simulation runs slower
+// than real time (time dilation) instead of spiralling.
+//
+// The scene is locked for each step only. Other threads lock sceneMutex() to touch the scene,
+// which waits for one step at most; the transforms to draw come from the snapshots without locks.
+class PhysicsThread {
+public:
+    // The app's step, also used by the scenes' offline settling and measurements
+    static constexpr float defaultTimeStep = 1.0f / 120.0f;
+
+    float fixedTimeStep = defaultTimeStep;
+    int maxStepsPerTick = 4;
+
+    PhysicsThread() = default;
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+    ~PhysicsThread();
+
+    // Publishes the scene's current state, then starts stepping it
+    void start(Scene* scene);
+    // Returns once the thread has finished its current step; the scene can then be deleted
+    void stop();
+
+    std::mutex& sceneMutex() { return mutex; }
+
+    // Render thread only
+    const PhysicsSnapshot& latestSnapshot() { return snapshots.latest(); }
+
+private:
+    Scene* scene = nullptr;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    TripleBuffer<PhysicsSnapshot> snapshots;
+    long long stepCount = 0;
+
+    void run();
+    void publish(double stepMs, float timeScale, double accumulator);   // Called with the scene locked
+};
+
+#endif // PHYSICSTHREAD_H
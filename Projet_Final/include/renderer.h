@@ -7,17 +7,19 @@
 #include <glm/glm.hpp>
 
 class Scene;
+struct PhysicsSnapshot;
 
 class Renderer {
 public:
     Renderer(unsigned int w, unsigned int h);
     ~Renderer();
 
-    double render(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool raytracingMode, bool wireframeMode);
+    // Objects are drawn where the snapshot puts them, so the scene may be stepping meanwhile
+    double render(Scene& scene, const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool raytracingMode, bool wireframeMode);
     
     void resize(unsigned int w, unsigned int h);
-    void renderRaster(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool wireframeMode);
-    double renderRaytraced(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
+    void renderRaster(const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool wireframeMode);
+    double renderRaytraced(Scene& scene, const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos);
 
     void initFramebuffers();
     void initScreenQuad();
@@ -4,23 +4,89 @@
 #include <vector>
 #include <glm/glm.hpp>
 #include "object.h"
+#include "broadphase.h"
+#include "meshcollider.h"
+#include "heightfield.h"
+#include "physicsprofiler.h"
+#include "solverstate.h"
 
 struct ContactConstraint {
     Object *objA, *objB;
     glm::vec3 contactPoint;
     glm::vec3 normal;
     float penetration;
-    
-    // PGS Cached values
-    glm::vec3 rA, rB;
-    float massNormal;     // 1 / (J M^-1 J^T)
-    float bias;           // Baumgarte + Restitution
-    float impulseSum;     // To clamp non-negative
-    
-    // Friction
-    glm::vec3 tangent1, tangent2;
-    float massTangent1, massTangent2;
-    float impulseTangent1, impulseTangent2;
+    int feature;          // Stable id of the generating feature within the pair (-1 if none)
+    int collider = 0;     // Static surface of a contact without objB: 0 for the floor, 1 + index for static
+                          // meshes, then one per heightfield after the meshes
+
+    // Solver indices of objA/objB (-1 for the floor), filled in by setBodies once the contact is appended
+    int bodyA = -1, bodyB = -1;
+};
+
+// [Solver rows] Everything a PGS visit needs, precomputed by the pre-step.
+// Index 0 is the normal, 1 and 2 the friction tangents.
+struct ContactRow {
+    int bodyA, bodyB;           // Body store indices, the floor being the store's world body
+    float invMassA, invMassB;
+    glm::vec3 normal, tangent1, tangent2;
+    glm::vec3 crossA[3], crossB[3];       // r x d
+    glm::vec3 angularA[3], angularB[3];   // invI * (r x d)
+    float mass[3];              // 1 / (J M^-1 J^T)
+    float impulse[3];           // Accumulated, clamped non-negative / inside the friction cone
+    float bias;                 // Baumgarte + Restitution
+    float friction;             // Combined coefficient of the two bodies
+
+    // [Sub-stepping] Used by the TGS mode, which recomputes the bias on every sub-step
+    float penetration;          // At detection, negative for speculative contacts
+    float normalVelocity;       // Relative normal velocity at detection
+    float restitution;
+    float maxImpulse;           // Largest normal impulse of the step, 0 if the contact never touched
+};
+
+// Accumulated impulses of one contact, carried to the next step for warm starting
+struct CachedContact {
+    const Object *objA, *objB;
+    int collider;               // Contacts only match contacts on the same static surface
+    int feature;
+    glm::vec3 localPointA;      // Contact point in A's body frame, for proximity matching
+    float impulseNormal;
+    glm::vec3 frictionImpulse;  // World space, since the tangent basis is rebuilt every step
+};
+
+// [Structure of arrays] Solver-owned copy of the state touched by integration and PGS,
+// indexed like the solver's object list plus a trailing static world body for floor contacts.
+// Synced with the Objects once per step.
+struct BodyStore {
+    std::vector<glm::vec3> position;
+    std::vector<glm::quat> orientation;
+    std::vector<glm::vec3> velocity;
+    std::vector<glm::vec3> angularVelocity;
+    std::vector<float> invMass;             // 0 for fixed and sleeping bodies
+    std::vector<glm::mat3> invInertiaWorld; // 0 for fixed and sleeping bodies
+    std::vector<glm::vec3> deltaPosition;   // Motion since the start of the step
+    std::vector<glm::vec3> deltaRotation;   // Rotation since the start of the step, as a rotation vector
+
+    int size() const { return (int)invMass.size() - 1; }
+    int world() const { return size(); }
+    void resize(int n);
+};
+
+enum class BroadPhaseMode {
+    BruteForce,   // O(n^2) bounding-sphere loop, kept as a reference
+    SpatialHash,  // Uniform grid rebuilt every step
+    AABBTree,     // Persistent dynamic tree, refit incrementally
+    SweepAndPrune // Persistent sorted endpoints, updated by insertion sort
+};
+
+enum class ParallelSolve {
+    Serial,       // One PGS sweep over all constraints
+    Islands,      // Independent contact islands solved concurrently
+    GraphColoring // Batches of constraints sharing no dynamic body, solved concurrently
+};
+
+enum class SolverMode {
+    PGS,          // One velocity solve of 'iterations' sweeps, then one position update
+    TGS           // [Temporal Gauss-Seidel] 'subSteps' soft sub-steps of one sweep each, detection once per step
 };
 
 class RigidSolver {
@@ -29,25 +95,148 @@ public:
     glm::vec3 gravity;
     float floorY;
 
+    // Broad phase
+    BroadPhaseMode broadPhase = BroadPhaseMode::AABBTree;
+    float cellSize = 2.0f;
+
+    // Constraint solver
+    ParallelSolve parallelSolve = ParallelSolve::Islands;
+    int iterations = 10;            // PGS cap, reached only by steps that do not converge
+    float solverTolerance = 1e-3f;  // Largest relative velocity change (m/s) of a converged PGS sweep
+    bool warmStarting = true;
+    SolverMode solverMode = SolverMode::PGS;
+    int subSteps = 4;
+
+    // Sleeping: islands resting for sleepSteps consecutive steps are skipped until touched
+    bool allowSleeping = true;
+    float sleepLinearVelocity = 0.05f;
+    float sleepAngularVelocity = 0.05f;
+    int sleepSteps = 150;
+
     RigidSolver(glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f), float floorY = -1.0f);
 
-    // Add an object to the simulation
+    // Add an object to the simulation. Whether it is fixed is read here: a fixed body must not move
+    // or be unfixed afterwards.
     void addObject(Object* object);
 
+    // Takes the object out of the simulation in O(1): the last body moves into its slot. A sleeping
+    // object wakes its island first, since what rested on it may now fall.
+    void removeObject(Object* object);
+    int getObjectCount() const { return (int)objects.size(); }
+
+    // Static triangle mesh (walls, ramps, terrain) baked with its model matrix. Bodies collide with
+    // its front faces like with the floor; it never moves, so its BVH is built here once.
+    void addStaticMesh(const Mesh& mesh, const glm::mat4& model);
+
+    // Heightfield whose samples its owner may rewrite between steps; bodies collide with its top side
+    void addHeightfield(const HeightfieldCollider& field);
+
     // Step the simulation forward
     void step(float deltaTime);
 
     // Reset all objects to their initial state (optional)
     void reset();
 
+    void wakeAll();
+    int getSleepingCount() const { return sleepingCount; }
+    int getAwakeCount() const { return awakeCount; }
+
+    // PGS sweeps of the last step (the slowest island's in island mode), or its TGS sub-steps
+    int getIterationsUsed() const { return iterationsUsed; }
+    const StepStats& getStepStats() const { return stats; }
+    // Stats of the last steps, recorded only in PHYSICS_PROFILING builds (empty otherwise)
+    PhysicsProfiler& getProfiler() { return profiler; }
+    const PhysicsProfiler& getProfiler() const { return profiler; }
+
+    // [Snapshot] Copies the whole simulation state into 'state', reusing its buffer
+    void saveState(SolverState& state) const;
+    // Puts every body and the contact cache back as saved, and returns true. Changes nothing and
+    // returns false unless the solver holds as many bodies as the state, fixed where they were fixed.
+    bool restoreState(const SolverState& state);
+
+    // Micro-benchmark: average cost in nanoseconds of one PGS row visit, re-solving the last
+    // step's rows serially 'repeats' times. Body velocities are restored afterwards.
+    double measureSolveCost(int repeats);
+
 private:
     std::vector<Object*> objects;
+    std::vector<TriangleMeshCollider> staticMeshes;
+    std::vector<HeightfieldCollider> heightfields;
     std::vector<ContactConstraint> constraints;
+    std::vector<ContactRow> rows;   // One per constraint, same order
+    StepStats stats;
+    PhysicsProfiler profiler;
+    long long stepCount = 0;
+
+    BodyStore bodies;
+    void loadBodies();
+    void loadBody(int i);
+    void storeBodies();
 
-    void detectCollisions();
+    // Broad phase scratch, kept between steps to reuse allocations
+    std::vector<AABB> bounds;
+    std::vector<BroadPhasePair> pairs;
+    SpatialHashGrid grid;
+    DynamicAABBTree tree;
+    std::vector<int> proxies;   // Tree leaf of each body
+    SweepAndPrune sap;
+    std::vector<int> sapProxies;    // -1 for static bodies
+
+    // Bodies fixed when added: their proxies[] entry is in staticTree, built as they come and never refit
+    std::vector<char> staticBodies;
+    DynamicAABBTree staticTree;
+    int staticCount = 0;
+    void findStaticPairs();
+
+    // Per-thread contact buffers, padded to their own cache lines
+    struct alignas(64) ContactArena {
+        std::vector<ContactConstraint> floorContacts, pairContacts;
+        int narrowTests[(int)ShapePair::Count];
+    };
+    std::vector<ContactArena> contactArenas;
+    std::vector<size_t> arenaOffsets;
+
+    // Fills 'constraints' from scratch
+    void detectCollisions(float dt);
+    AABB computeBounds(const Object* obj) const;
+    void updateBounds(float dt);
+    float closingDistance(int a, int b, float dt) const;
+    void collideFloor(Object* obj, float margin, std::vector<ContactConstraint>& out);
+    void collideStaticMeshes(Object* obj, float margin, std::vector<ContactConstraint>& out) const;
+    void collideHeightfields(Object* obj, float margin, std::vector<ContactConstraint>& out) const;
+    void collidePair(Object* A, Object* B, float margin, std::vector<ContactConstraint>& out);
     void solve(float dt);
-    
-    bool isPointInsideObject(const glm::vec3& p, Object* obj, glm::vec3& normal, float& penetration);
+    int iterationsUsed = 0;
+    void solveSubSteps(float dt);
+    void integratePositions(float h);
+    void updateInertia();
+    template <typename Kernel> void sweepRows(const Kernel& kernel);
+
+    // Contact impulses of the previous step, sorted by body pair then feature
+    std::vector<CachedContact> contactCache;
+    void recallImpulses(const ContactConstraint& c, ContactRow& row) const;
+    void storeImpulses();
+
+    // Island scratch, rebuilt every step
+    std::vector<int> islandParent, bodyIsland;
+    std::vector<int> constraintIsland, islandStarts, islandFill, islandConstraints;
+    void buildIslands();
+
+    // Graph coloring scratch
+    std::vector<uint64_t> bodyColors;   // Bit c set when the body already has a constraint of color c
+    std::vector<int> constraintColor, colorStarts, colorFill, colorConstraints;
+    void buildColors();
+
+    // Sleeping: island each sleeping body went to sleep with (-1 when awake)
+    std::vector<int> sleepGroup;
+    std::vector<int> groupSleepCounter;
+    std::vector<char> wakeGroups;
+    int sleepingCount = 0, awakeCount = 0;
+    void wakeBody(int body);
+    void wakeFlaggedGroups();
+    bool wakeTouchedBodies();
+    void updateSleep();
+
 };
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "object.h"
 #include "rigidsolver.h"
+#include "objectpool.h"
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -21,11 +22,31 @@ public:
     Scene();
     virtual ~Scene(); // Virtual destructor is crucial for base classes
 
+    // Bodies leaving this box are culled; bodies from acquireObject() also expire after maxLifetime
+    // seconds (negative for no limit). Culled bodies go back to the pool.
+    AABB killVolume = {glm::vec3(-1000.0f), glm::vec3(1000.0f)};
+    float maxLifetime = 60.0f;
+
     virtual void step(float dt);
+    // On the render thread with the scene locked: GL uploads of what the last steps changed
+    virtual void prepareRender() {}
     void addObject(Object* obj);
+    // Rendered like any object, but collides as a static triangle mesh instead of a body
+    void addStaticObject(Object* obj);
+
+    // [Object pool] A recycled or new object for bodies spawned at run time, with its lifetime set.
+    // Give it its shape and state, then addObject() it.
+    Object* acquireObject(Mesh* mesh, Material* material);
+    // Swap-removes the object from the scene and the solver in O(1); the caller then owns it.
+    // Objects added with addStaticObject() keep colliding.
+    void removeObject(Object* obj);
 
     // Input handling is now virtual, to be overridden by derived scenes
     virtual void processInput(GLFWwindow* window, const glm::vec3& cameraPos, const glm::mat4& view, const glm::mat4& projection);
+
+protected:
+    ObjectPool pool;
+    void cullObjects(float dt);
 };
 
 
@@ -50,6 +71,25 @@ private:
 };
 
 
+// --- Solver Stress Scene ---
+// A single large pyramid of boxes (one contact island). Press M to time the
+// constraint solver for increasing thread counts and print the speedup.
+class SolverStressScene : public Scene {
+public:
+    SolverStressScene();
+    virtual ~SolverStressScene();
+    virtual void processInput(GLFWwindow* window, const glm::vec3& cameraPos, const glm::mat4& view, const glm::mat4& projection) override;
+
+private:
+    void measureSpeedup();
+
+    Mesh* boxMesh = nullptr;
+    std::vector<Material*> boxMaterials;
+    Mesh* groundMesh = nullptr;
+    Material* groundMaterial = nullptr;
+};
+
+
 class RayTracingScene : public Scene {
 public:
     RayTracingScene();
@@ -106,9 +146,11 @@ public:
     virtual ~SeaScene();
     virtual void processInput(GLFWwindow* window, const glm::vec3& cameraPos, const glm::mat4& view, const glm::mat4& projection) override;
     virtual void step(float dt) override;
+    virtual void prepareRender() override;
 
 private:
     Mesh *seaMesh = nullptr;
+    bool seaMeshDirty = false;  // Vertices rewritten since the last upload
     Material *seaMat = nullptr;
     Object *seaObject = nullptr;
     
@@ -119,6 +161,12 @@ private:
     Object *sun = nullptr;
     Mesh *sunMesh = nullptr;
     Material *sunMat = nullptr;
+
+    // Bodies bouncing on the sea's heightfield
+    Mesh *crateMesh = nullptr;
+    Mesh *buoyMesh = nullptr;
+    Material *driftMat = nullptr;
+
     float time = 0.0f;
 
     int gridRes = 15;
@@ -0,0 +1,26 @@
+#ifndef SOLVERSTATE_H
+#define SOLVERSTATE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// [Snapshot] Complete simulation state of a RigidSolver in one contiguous buffer: a header, one
+// record per body (kinematics, world inertia, sleep state) and the warm-start contact cache.
+// Bodies are referred to by index, never by pointer, so the buffer can be copied with memcpy,
+// written to a file, and restored into any solver holding the same objects in the same order.
+class SolverState {
+public:
+    bool empty() const { return data.empty(); }
+    size_t size() const { return data.size(); }
+    const unsigned char* bytes() const { return data.data(); }
+
+    bool writeFile(const std::string& path) const;
+    bool readFile(const std::string& path);
+
+private:
+    friend class RigidSolver;
+    std::vector<unsigned char> data;    // Keeps its capacity, so saving into it again does not allocate
+};
+
+#endif // SOLVERSTATE_H
@@ -0,0 +1,539 @@
+#include "broadphase.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <omp.h>
+
+// --- SpatialHashGrid ---
+
+SpatialHashGrid::SpatialHashGrid(float cellSize, int maxCellsPerAxis)
+    : cellSize(cellSize), maxCellsPerAxis(maxCellsPerAxis) {}
+
+glm::ivec3 SpatialHashGrid::cellOf(const glm::vec3& p) const {
+    return glm::ivec3(glm::floor(p / cellSize));
+}
+
+// 21 bits per axis: exact for cell coordinates in [-2^20, 2^20), so distinct cells never collide
+uint64_t SpatialHashGrid::packKey(const glm::ivec3& c) {
+    const uint64_t mask = (1ull << 21) - 1;
+    return ((uint64_t)(c.x + (1 << 20)) & mask) << 42 |
+           ((uint64_t)(c.y + (1 << 20)) & mask) << 21 |
+           ((uint64_t)(c.z + (1 << 20)) & mask);
+}
+
+void SpatialHashGrid::build(const std::vector<AABB>& bounds) {
+    entries.clear();
+    oversized.clear();
+
+    for (int i = 0; i < (int)bounds.size(); ++i) {
+        // Empty boxes (min > max) stand for bodies kept out of the grid
+        if (bounds[i].min.x > bounds[i].max.x) continue;
+        glm::ivec3 lo = cellOf(bounds[i].min);
+        glm::ivec3 hi = cellOf(bounds[i].max);
+        glm::ivec3 span = hi - lo + 1;
+        if (span.x > maxCellsPerAxis || span.y > maxCellsPerAxis || span.z > maxCellsPerAxis) {
+            oversized.push_back(i);
+            continue;
+        }
+        for (int x = lo.x; x <= hi.x; ++x)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int z = lo.z; z <= hi.z; ++z)
+                    entries.push_back({packKey(glm::ivec3(x, y, z)), i});
+    }
+
+    std::sort(entries.begin(), entries.end());
+}
+
+void SpatialHashGrid::findPairs(const std::vector<AABB>& bounds, std::vector<BroadPhasePair>& pairs) const {
+    pairs.clear();
+
+    // Walk each run of entries sharing a cell
+    size_t runStart = 0;
+    while (runStart < entries.size()) {
+        size_t runEnd = runStart + 1;
+        while (runEnd < entries.size() && entries[runEnd].key == entries[runStart].key) ++runEnd;
+
+        for (size_t i = runStart; i < runEnd; ++i) {
+            for (size_t j = i + 1; j < runEnd; ++j) {
+                int a = entries[i].body, b = entries[j].body;
+                const AABB &A = bounds[a], &B = bounds[b];
+                if (!A.overlaps(B)) continue;
+
+                // Only the cell containing the overlap's min corner reports the pair
+                if (packKey(cellOf(glm::max(A.min, B.min))) != entries[i].key) continue;
+                pairs.push_back({std::min(a, b), std::max(a, b)});
+            }
+        }
+        runStart = runEnd;
+    }
+
+    // Oversized boxes against everything else
+    for (size_t k = 0; k < oversized.size(); ++k) {
+        int a = oversized[k];
+        for (int b = 0; b < (int)bounds.size(); ++b) {
+            if (b == a) continue;
+            // Two oversized boxes are reported once, by the lower index
+            bool bOversized = std::binary_search(oversized.begin(), oversized.end(), b);
+            if (bOversized && b < a) continue;
+            if (bounds[a].overlaps(bounds[b])) pairs.push_back({std::min(a, b), std::max(a, b)});
+        }
+    }
+
+    // Same order as the brute-force loop, so both paths feed the solver identically
+    std::sort(pairs.begin(), pairs.end());
+}
+
+// --- DynamicAABBTree ---
+
+DynamicAABBTree::DynamicAABBTree(float fatMargin)
+    : fatMargin(fatMargin), root(-1), freeList(-1) {}
+
+int DynamicAABBTree::allocateNode() {
+    int node;
+    if (freeList != -1) {
+        node = freeList;
+        freeList = nodes[node].parent;
+    } else {
+        node = (int)nodes.size();
+        nodes.push_back(Node());
+    }
+    nodes[node].parent = nodes[node].child1 = nodes[node].child2 = -1;
+    nodes[node].height = 0;
+    nodes[node].body = -1;
+    return node;
+}
+
+void DynamicAABBTree::freeNode(int node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+int DynamicAABBTree::createProxy(const AABB& box, int body) {
+    int proxy = allocateNode();
+    nodes[proxy].box = {box.min - fatMargin, box.max + fatMargin};
+    nodes[proxy].body = body;
+    insertLeaf(proxy);
+    return proxy;
+}
+
+void DynamicAABBTree::destroyProxy(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+}
+
+bool DynamicAABBTree::moveProxy(int proxy, const AABB& box) {
+    if (nodes[proxy].box.contains(box)) return false;
+    removeLeaf(proxy);
+    nodes[proxy].box = {box.min - fatMargin, box.max + fatMargin};
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::insertLeaf(int leaf) {
+    if (root == -1) {
+        root = leaf;
+        nodes[root].parent = -1;
+        return;
+    }
+
+    // [Surface area heuristic] Descend towards the cheapest sibling
+    AABB leafBox = nodes[leaf].box;
+    int index = root;
+    while (!nodes[index].isLeaf()) {
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+
+        float area = nodes[index].box.area();
+        float combinedArea = AABB::merge(nodes[index].box, leafBox).area();
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            float merged = AABB::merge(leafBox, nodes[child].box).area();
+            if (nodes[child].isLeaf()) return merged + inheritanceCost;
+            return merged - nodes[child].box.area() + inheritanceCost;
+        };
+        float cost1 = descendCost(child1);
+        float cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = (cost1 < cost2) ? child1 : child2;
+    }
+    int sibling = index;
+
+    // Create a new parent for the sibling and the leaf
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = AABB::merge(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != -1) {
+        if (nodes[oldParent].child1 == sibling) nodes[oldParent].child1 = newParent;
+        else nodes[oldParent].child2 = newParent;
+    } else {
+        root = newParent;
+    }
+
+    // Walk back up, rebalancing and refitting
+    index = nodes[leaf].parent;
+    while (index != -1) {
+        index = balance(index);
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+        nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[index].box = AABB::merge(nodes[child1].box, nodes[child2].box);
+        index = nodes[index].parent;
+    }
+}
+
+void DynamicAABBTree::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = -1;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == -1) {
+        root = sibling;
+        nodes[sibling].parent = -1;
+        freeNode(parent);
+        return;
+    }
+
+    // Splice the sibling in place of the parent
+    if (nodes[grandParent].child1 == parent) nodes[grandParent].child1 = sibling;
+    else nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    int index = grandParent;
+    while (index != -1) {
+        index = balance(index);
+        int child1 = nodes[index].child1;
+        int child2 = nodes[index].child2;
+        nodes[index].box = AABB::merge(nodes[child1].box, nodes[child2].box);
+        nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        index = nodes[index].parent;
+    }
+}
+
+// [Tree rotation] Promote the taller grandchild when the subtree is unbalanced. Returns the new subtree root.
+int DynamicAABBTree::balance(int iA) {
+    Node& A = nodes[iA];
+    if (A.isLeaf() || A.height < 2) return iA;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    Node& B = nodes[iB];
+    Node& C = nodes[iC];
+    int diff = C.height - B.height;
+
+    // Rotate C up
+    if (diff > 1) {
+        int iF = C.child1;
+        int iG = C.child2;
+        Node& F = nodes[iF];
+        Node& G = nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        if (C.parent != -1) {
+            if (nodes[C.parent].child1 == iA) nodes[C.parent].child1 = iC;
+            else nodes[C.parent].child2 = iC;
+        } else {
+            root = iC;
+        }
+
+        if (F.height > G.height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = AABB::merge(B.box, G.box);
+            C.box = AABB::merge(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = AABB::merge(B.box, F.box);
+            C.box = AABB::merge(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (diff < -1) {
+        int iD = B.child1;
+        int iE = B.child2;
+        Node& D = nodes[iD];
+        Node& E = nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        if (B.parent != -1) {
+            if (nodes[B.parent].child1 == iA) nodes[B.parent].child1 = iB;
+            else nodes[B.parent].child2 = iB;
+        } else {
+            root = iB;
+        }
+
+        if (D.height > E.height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = AABB::merge(C.box, E.box);
+            B.box = AABB::merge(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = AABB::merge(C.box, D.box);
+            B.box = AABB::merge(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void DynamicAABBTree::findPairs(std::vector<BroadPhasePair>& pairs) const {
+    pairs.clear();
+    if (root == -1) return;
+
+    int maxThreads = omp_get_max_threads();
+    if ((int)queryArenas.size() < maxThreads) queryArenas.resize(maxThreads);
+    arenaOffsets.resize(maxThreads + 1);
+
+    // Every leaf queries the tree; a pair is kept by its lower body index only
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        int threadCount = omp_get_num_threads();
+        std::vector<BroadPhasePair>& localPairs = queryArenas[thread].pairs;
+        std::vector<int>& stack = queryArenas[thread].stack;
+        localPairs.clear();
+
+        #pragma omp for
+        for (int leaf = 0; leaf < (int)nodes.size(); ++leaf) {
+            if (nodes[leaf].height != 0) continue;
+            const AABB& box = nodes[leaf].box;
+            int body = nodes[leaf].body;
+
+            stack.clear();
+            stack.push_back(root);
+            while (!stack.empty()) {
+                int index = stack.back();
+                stack.pop_back();
+                const Node& node = nodes[index];
+                if (!node.box.overlaps(box)) continue;
+                if (node.isLeaf()) {
+                    if (node.body > body) localPairs.push_back({body, node.body});
+                } else {
+                    stack.push_back(node.child1);
+                    stack.push_back(node.child2);
+                }
+            }
+        }
+
+        // Prefix sum over the threads' pair counts, then each thread copies its own range
+        #pragma omp single
+        {
+            arenaOffsets[0] = 0;
+            for (int t = 0; t < threadCount; ++t) arenaOffsets[t + 1] = arenaOffsets[t] + queryArenas[t].pairs.size();
+            pairs.resize(arenaOffsets[threadCount]);
+        }
+        std::copy(localPairs.begin(), localPairs.end(), pairs.begin() + arenaOffsets[thread]);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
+
+// --- SweepAndPrune ---
+
+int SweepAndPrune::createProxy(const AABB& box, int body) {
+    if (!freeProxies.empty()) {
+        // The free proxy still owns its endpoints: moving them is enough, the next update sorts
+        // them back in and reports the new pairs
+        int proxy = freeProxies.back();
+        freeProxies.pop_back();
+        proxies[proxy].body = body;
+        moveProxy(proxy, box);
+        return proxy;
+    }
+
+    int proxy = (int)proxies.size();
+    proxies.push_back(Proxy());
+    proxies[proxy].box = box;
+    proxies[proxy].body = body;
+
+    // Appended at the end of each axis; the next update sorts them in and reports their pairs
+    for (int k = 0; k < 3; ++k) {
+        proxies[proxy].minIndex[k] = (int)axes[k].size();
+        axes[k].push_back({box.min[k], proxy, false});
+        proxies[proxy].maxIndex[k] = (int)axes[k].size();
+        axes[k].push_back({box.max[k], proxy, true});
+    }
+    return proxy;
+}
+
+void SweepAndPrune::destroyProxy(int proxy) {
+    // Rather than erasing its endpoints, send the box to +infinity: the next update sorts them to
+    // the end of the axes, and drops the proxy's pairs in one pass for all the proxies destroyed
+    AABB gone = {glm::vec3(FLT_MAX), glm::vec3(FLT_MAX)};
+    moveProxy(proxy, gone);
+    proxies[proxy].body = -1;
+    freeProxies.push_back(proxy);
+    destroyedProxies = true;
+}
+
+void SweepAndPrune::moveProxy(int proxy, const AABB& box) {
+    Proxy& p = proxies[proxy];
+    p.box = box;
+    for (int k = 0; k < 3; ++k) {
+        axes[k][p.minIndex[k]].value = box.min[k];
+        axes[k][p.maxIndex[k]].value = box.max[k];
+    }
+}
+
+uint64_t SweepAndPrune::pairKey(int p, int q) {
+    if (p > q) std::swap(p, q);
+    return ((uint64_t)p << 32) | (uint32_t)q;
+}
+
+BroadPhasePair SweepAndPrune::bodyPair(uint64_t key) const {
+    int a = proxies[key >> 32].body, b = proxies[key & 0xffffffffu].body;
+    return {std::min(a, b), std::max(a, b)};
+}
+
+int SweepAndPrune::homeSlot(uint64_t key) const {
+    // Fibonacci hashing: the upper half of the product mixes both proxy ids
+    return (int)((key * 0x9e3779b97f4a7c15ull) >> 32) & ((int)slotKeys.size() - 1);
+}
+
+int SweepAndPrune::findSlot(uint64_t key) const {
+    int mask = (int)slotKeys.size() - 1;
+    int i = homeSlot(key);
+    while (slotKeys[i] != key && slotKeys[i] != emptyKey) i = (i + 1) & mask;
+    return i;
+}
+
+void SweepAndPrune::eraseSlot(int position) {
+    // Backward-shift deletion: pull later entries of the run into the hole when their home
+    // position allows it, so lookups never need tombstones
+    int mask = (int)slotKeys.size() - 1;
+    int hole = position;
+    for (int i = (hole + 1) & mask; slotKeys[i] != emptyKey; i = (i + 1) & mask) {
+        int home = homeSlot(slotKeys[i]);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            slotKeys[hole] = slotKeys[i];
+            slotValues[hole] = slotValues[i];
+            hole = i;
+        }
+    }
+    slotKeys[hole] = emptyKey;
+    --slotCount;
+}
+
+void SweepAndPrune::growSlots() {
+    int size = std::max(64, (int)slotKeys.size() * 2);
+    slotKeys.assign(size, emptyKey);
+    slotValues.assign(size, 0);
+    for (int slot = 0; slot < (int)pairList.size(); ++slot) {
+        int position = findSlot(pairList[slot]);
+        slotKeys[position] = pairList[slot];
+        slotValues[position] = slot;
+    }
+}
+
+void SweepAndPrune::addPair(int p, int q) {
+    // Destroyed proxies all sit at +infinity, where they overlap each other
+    if (proxies[p].body < 0 || proxies[q].body < 0) return;
+
+    uint64_t key = pairKey(p, q);
+    if (2 * (slotCount + 1) > (int)slotKeys.size()) growSlots();
+    int position = findSlot(key);
+    if (slotKeys[position] == key) return;
+    slotKeys[position] = key;
+    slotValues[position] = (int)pairList.size();
+    ++slotCount;
+    pairList.push_back(key);
+    addedPairs.push_back(bodyPair(key));
+}
+
+void SweepAndPrune::removePair(int p, int q) {
+    if (slotCount == 0) return;
+    uint64_t key = pairKey(p, q);
+    int position = findSlot(key);
+    if (slotKeys[position] != key) return;
+    removedPairs.push_back(bodyPair(key));
+
+    // Swap-remove from the dense list
+    int slot = slotValues[position];
+    eraseSlot(position);
+    if (slot != (int)pairList.size() - 1) {
+        pairList[slot] = pairList.back();
+        slotValues[findSlot(pairList[slot])] = slot;
+    }
+    pairList.pop_back();
+}
+
+void SweepAndPrune::sortAxis(int axis) {
+    std::vector<Endpoint>& e = axes[axis];
+    for (int i = 1; i < (int)e.size(); ++i) {
+        Endpoint key = e[i];
+        int j = i - 1;
+        while (j >= 0 && e[j].value > key.value) {
+            const Endpoint& other = e[j];
+            if (!key.isMax && other.isMax) {
+                // A min moved left of a max: the boxes may start overlapping
+                if (proxies[key.proxy].box.overlaps(proxies[other.proxy].box)) addPair(key.proxy, other.proxy);
+            } else if (key.isMax && !other.isMax) {
+                // A max moved left of a min: the boxes stopped overlapping
+                removePair(key.proxy, other.proxy);
+            }
+
+            e[j + 1] = other;
+            if (other.isMax) proxies[other.proxy].maxIndex[axis] = j + 1;
+            else proxies[other.proxy].minIndex[axis] = j + 1;
+            --j;
+        }
+        e[j + 1] = key;
+        if (key.isMax) proxies[key.proxy].maxIndex[axis] = j + 1;
+        else proxies[key.proxy].minIndex[axis] = j + 1;
+    }
+}
+
+void SweepAndPrune::update() {
+    if (destroyedProxies) {
+        for (int i = (int)pairList.size() - 1; i >= 0; --i) {
+            int p = (int)(pairList[i] >> 32), q = (int)(pairList[i] & 0xffffffffu);
+            if (proxies[p].body < 0 || proxies[q].body < 0) removePair(p, q);
+        }
+        destroyedProxies = false;
+    }
+    for (int k = 0; k < 3; ++k) sortAxis(k);
+}
+
+void SweepAndPrune::getPairs(std::vector<BroadPhasePair>& pairs) const {
+    pairs.resize(pairList.size());
+    for (size_t i = 0; i < pairList.size(); ++i) pairs[i] = bodyPair(pairList[i]);
+    std::sort(pairs.begin(), pairs.end());
+}
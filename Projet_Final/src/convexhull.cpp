@@ -0,0 +1,233 @@
+#include "convexhull.h"
+#include <algorithm>
+#include <cfloat>
+#include <unordered_map>
+
+int ConvexHull::support(const glm::vec3& dir) const {
+    int best = 0;
+    float bestDot = -FLT_MAX;
+    for (int i = 0; i < (int)vertices.size(); ++i) {
+        float d = glm::dot(vertices[i], dir);
+        if (d > bestDot) { bestDot = d; best = i; }
+    }
+    return best;
+}
+
+namespace {
+
+struct HullFace {
+    int v[3];
+    glm::vec3 normal;
+    float offset;
+    std::vector<int> outside;   // Points above this face, waiting to be processed
+    bool alive;
+    int visited;                // Stamp of the last visibility search that reached the face
+};
+
+uint64_t edgeKey(int a, int b) {
+    return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+}
+
+// Hull without faces: the support mapping still works on the raw points
+static ConvexHull pointHull(const std::vector<glm::vec3>& points) {
+    ConvexHull hull;
+    hull.vertices = points;
+    return hull;
+}
+
+static void finishBounds(ConvexHull& hull) {
+    hull.boundsMin = hull.boundsMax = hull.vertices[0];
+    hull.radius = 0.0f;
+    for (const auto& v : hull.vertices) {
+        hull.boundsMin = glm::min(hull.boundsMin, v);
+        hull.boundsMax = glm::max(hull.boundsMax, v);
+        hull.radius = std::max(hull.radius, glm::length(v));
+    }
+}
+
+ConvexHull buildConvexHull(const std::vector<glm::vec3>& points) {
+    if (points.empty()) return ConvexHull();
+
+    // Tolerance relative to the size of the cloud
+    glm::vec3 maxAbs(0.0f);
+    for (const auto& p : points) maxAbs = glm::max(maxAbs, glm::abs(p));
+    float eps = std::max(1e-5f * (maxAbs.x + maxAbs.y + maxAbs.z), FLT_MIN);
+
+    // Initial tetrahedron: the farthest pair of axis extremes, the point farthest from their line,
+    // then the point farthest from the plane of the three
+    int extremes[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < (int)points.size(); ++i) {
+        for (int k = 0; k < 3; ++k) {
+            if (points[i][k] < points[extremes[2 * k]][k]) extremes[2 * k] = i;
+            if (points[i][k] > points[extremes[2 * k + 1]][k]) extremes[2 * k + 1] = i;
+        }
+    }
+    int i0 = 0, i1 = 0;
+    float bestDist = -1.0f;
+    for (int k = 0; k < 3; ++k) {
+        float dist = glm::distance(points[extremes[2 * k]], points[extremes[2 * k + 1]]);
+        if (dist > bestDist) { bestDist = dist; i0 = extremes[2 * k]; i1 = extremes[2 * k + 1]; }
+    }
+    if (bestDist < eps) {
+        ConvexHull hull = pointHull({points[i0]});
+        finishBounds(hull);
+        return hull;
+    }
+
+    glm::vec3 lineDir = glm::normalize(points[i1] - points[i0]);
+    int i2 = -1;
+    bestDist = eps;
+    for (int i = 0; i < (int)points.size(); ++i) {
+        glm::vec3 d = points[i] - points[i0];
+        float dist = glm::length(d - lineDir * glm::dot(d, lineDir));
+        if (dist > bestDist) { bestDist = dist; i2 = i; }
+    }
+
+    int i3 = -1;
+    if (i2 >= 0) {
+        glm::vec3 planeNormal = glm::normalize(glm::cross(points[i1] - points[i0], points[i2] - points[i0]));
+        bestDist = eps;
+        for (int i = 0; i < (int)points.size(); ++i) {
+            float dist = std::abs(glm::dot(points[i] - points[i0], planeNormal));
+            if (dist > bestDist) { bestDist = dist; i3 = i; }
+        }
+    }
+
+    // Collinear or flat cloud
+    if (i3 < 0) {
+        ConvexHull hull = pointHull(points);
+        finishBounds(hull);
+        return hull;
+    }
+
+    std::vector<HullFace> faces;
+    std::unordered_map<uint64_t, int> edgeFace;   // Directed edge -> face having it counter-clockwise
+
+    auto addFace = [&](int a, int b, int c) {
+        HullFace f;
+        f.v[0] = a; f.v[1] = b; f.v[2] = c;
+        glm::vec3 n = glm::cross(points[b] - points[a], points[c] - points[a]);
+        float len = glm::length(n);
+        f.normal = (len > 0.0f) ? n / len : glm::vec3(0.0f);
+        f.offset = glm::dot(f.normal, points[a]);
+        f.alive = true;
+        f.visited = -1;
+        for (int e = 0; e < 3; ++e) edgeFace[edgeKey(f.v[e], f.v[(e + 1) % 3])] = (int)faces.size();
+        faces.push_back(std::move(f));
+    };
+
+    // Orient the tetrahedron's faces away from its centroid
+    glm::vec3 centroid = (points[i0] + points[i1] + points[i2] + points[i3]) * 0.25f;
+    int tetra[4][3] = {{i0, i1, i2}, {i0, i3, i1}, {i1, i3, i2}, {i2, i3, i0}};
+    {
+        glm::vec3 n = glm::cross(points[i1] - points[i0], points[i2] - points[i0]);
+        if (glm::dot(n, centroid - points[i0]) > 0.0f) {
+            // i3 lies on the positive side of (i0, i1, i2): flip every face
+            for (auto& t : tetra) std::swap(t[1], t[2]);
+        }
+    }
+    for (auto& t : tetra) addFace(t[0], t[1], t[2]);
+
+    // Each remaining point goes to the face it is farthest above, if any
+    auto assign = [&](int point, int firstFace) {
+        int best = -1;
+        float bestDist = eps;
+        for (int f = firstFace; f < (int)faces.size(); ++f) {
+            if (!faces[f].alive) continue;
+            float dist = glm::dot(faces[f].normal, points[point]) - faces[f].offset;
+            if (dist > bestDist) { bestDist = dist; best = f; }
+        }
+        if (best >= 0) faces[best].outside.push_back(point);
+    };
+    for (int i = 0; i < (int)points.size(); ++i) {
+        if (i == i0 || i == i1 || i == i2 || i == i3) continue;
+        assign(i, 0);
+    }
+
+    std::vector<int> visible, stack, orphans;
+    std::vector<std::pair<int, int>> horizon;
+    int search = 0;
+    for (int current = 0; current < (int)faces.size(); ++current) {
+        if (!faces[current].alive || faces[current].outside.empty()) continue;
+
+        // Farthest point above the face
+        int eye = -1;
+        float eyeDist = -FLT_MAX;
+        for (int p : faces[current].outside) {
+            float dist = glm::dot(faces[current].normal, points[p]) - faces[current].offset;
+            if (dist > eyeDist) { eyeDist = dist; eye = p; }
+        }
+
+        // Flood the faces the eye point sees; edges towards faces it does not see form the horizon
+        visible.clear();
+        horizon.clear();
+        stack.assign(1, current);
+        faces[current].visited = search;
+        while (!stack.empty()) {
+            int f = stack.back();
+            stack.pop_back();
+            visible.push_back(f);
+            for (int e = 0; e < 3; ++e) {
+                int a = faces[f].v[e], b = faces[f].v[(e + 1) % 3];
+                auto it = edgeFace.find(edgeKey(b, a));
+                if (it == edgeFace.end()) continue;
+                HullFace& neighbor = faces[it->second];
+                if (neighbor.visited == search) continue;
+                float height = glm::dot(neighbor.normal, points[eye]) - neighbor.offset;
+                bool seen = height > eps;
+                if (!seen && height > 0.0f) {
+                    // Barely seen: the new face on this edge would still fold over the neighbor when
+                    // the neighbor is much wider than the eye is high, so judge by its far vertex
+                    int c = neighbor.v[0] + neighbor.v[1] + neighbor.v[2] - a - b;
+                    glm::vec3 n = glm::cross(points[b] - points[a], points[eye] - points[a]);
+                    float len = glm::length(n);
+                    seen = len > 0.0f && glm::dot(n, points[c] - points[a]) > eps * len;
+                }
+                if (seen) {
+                    neighbor.visited = search;
+                    stack.push_back(it->second);
+                } else {
+                    horizon.push_back({a, b});
+                }
+            }
+        }
+        ++search;
+
+        orphans.clear();
+        for (int f : visible) {
+            for (int p : faces[f].outside) {
+                if (p != eye) orphans.push_back(p);
+            }
+            faces[f].outside.clear();
+            faces[f].alive = false;
+            for (int e = 0; e < 3; ++e) edgeFace.erase(edgeKey(faces[f].v[e], faces[f].v[(e + 1) % 3]));
+        }
+
+        // Fan of new faces from the horizon to the eye point; orientation follows the removed faces
+        int firstNew = (int)faces.size();
+        for (const auto& edge : horizon) addFace(edge.first, edge.second, eye);
+        for (int p : orphans) assign(p, firstNew);
+    }
+
+    // Keep the live faces and the vertices they use, renumbered
+    ConvexHull hull;
+    std::vector<int> remap(points.size(), -1);
+    for (const auto& f : faces) {
+        if (!f.alive) continue;
+        glm::ivec3 tri;
+        for (int e = 0; e < 3; ++e) {
+            int v = f.v[e];
+            if (remap[v] < 0) {
+                remap[v] = (int)hull.vertices.size();
+                hull.vertices.push_back(points[v]);
+            }
+            tri[e] = remap[v];
+        }
+        hull.triangles.push_back(tri);
+        hull.planes.push_back(glm::vec4(f.normal, f.offset));
+    }
+    finishBounds(hull);
+    return hull;
+}
@@ -0,0 +1,34 @@
+#include "heightfield.h"
+#include <algorithm>
+#include <cmath>
+
+HeightfieldCollider::HeightfieldCollider(const float* heights, int stride, int resX, int resZ, const glm::vec2& origin, float cellSize)
+    : heights(heights), stride(stride), resX(resX), resZ(resZ), origin(origin), cellSize(cellSize) {}
+
+bool HeightfieldCollider::sample(float x, float z, float& h, glm::vec3& normal) const {
+    float gx = (x - origin.x) / cellSize;
+    float gz = (z - origin.y) / cellSize;
+    if (!(gx >= 0.0f && gz >= 0.0f && gx <= resX - 1 && gz <= resZ - 1)) return false;
+
+    // Points on the far borders belong to the last cell
+    int cx = std::min((int)gx, resX - 2);
+    int cz = std::min((int)gz, resZ - 2);
+    float u = gx - cx, v = gz - cz;
+
+    float h10 = height(cx + 1, cz);
+    float h01 = height(cx, cz + 1);
+    float slopeX, slopeZ;   // Height change per cell along x and z
+    if (u + v <= 1.0f) {
+        float h00 = height(cx, cz);
+        slopeX = h10 - h00;
+        slopeZ = h01 - h00;
+        h = h00 + u * slopeX + v * slopeZ;
+    } else {
+        float h11 = height(cx + 1, cz + 1);
+        slopeX = h11 - h01;
+        slopeZ = h11 - h10;
+        h = h11 - (1.0f - u) * slopeX - (1.0f - v) * slopeZ;
+    }
+    normal = glm::normalize(glm::vec3(-slopeX, cellSize, -slopeZ));
+    return true;
+}
@@ -7,6 +7,7 @@
 #include "scene.h"
 #include "renderer.h"
 #include "window.h"
+#include "physicsthread.h"
 
 #include <iostream>
 #include <cmath>
@@ -28,7 +29,6 @@ const unsigned int SCR_HEIGHT = 800;
 // Timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
-float timeAccumulator = 0.0f;
 
 int main()
 {
@@ -37,7 +37,12 @@ int main()
         Renderer renderer(window.width, window.height);
         Scene* currentScene = new PhysicsStackScene();
 
-        double totalPhysTime = 0.0; 
+        // Physics steps on its own thread; this loop only reads its snapshots, and locks the
+        // scene for input and uploads (waiting for one step at most)
+        PhysicsThread physics;
+        // Speculative contacts keep fast bolts from tunneling, so the step no longer has to be tiny
+        physics.fixedTimeStep = PhysicsThread::defaultTimeStep;
+        physics.start(currentScene);
 
         // Render loop
         while (!window.shouldClose())
@@ -47,54 +52,44 @@ int main()
             deltaTime = currentFrame - lastFrame;
             lastFrame = currentFrame;
 
-            window.processInput(*currentScene, deltaTime);
-
-            // Toggle Scene logic with keyboard keys '1' and '2'
+            // Toggle Scene logic with keyboard keys '1' to '6'
+            Scene* nextScene = nullptr;
             if (glfwGetKey(window.ptr, GLFW_KEY_1) == GLFW_PRESS) {
-                if (!dynamic_cast<PhysicsStackScene*>(currentScene)) {
-                    delete currentScene;
-                    currentScene = new PhysicsStackScene();
-                }
-            }
-            if (glfwGetKey(window.ptr, GLFW_KEY_2) == GLFW_PRESS) {
-                if (!dynamic_cast<RayTracingScene*>(currentScene)) {
-                    delete currentScene;
-                    currentScene = new RayTracingScene();
-                }
-            }
-            if (glfwGetKey(window.ptr, GLFW_KEY_3) == GLFW_PRESS) {
-                if (!dynamic_cast<MirrorScene*>(currentScene)) {
-                    delete currentScene;
-                    currentScene = new MirrorScene();
-                }
+                if (!dynamic_cast<PhysicsStackScene*>(currentScene)) nextScene = new PhysicsStackScene();
+            } else if (glfwGetKey(window.ptr, GLFW_KEY_2) == GLFW_PRESS) {
+                if (!dynamic_cast<RayTracingScene*>(currentScene)) nextScene = new RayTracingScene();
+            } else if (glfwGetKey(window.ptr, GLFW_KEY_3) == GLFW_PRESS) {
+                if (!dynamic_cast<MirrorScene*>(currentScene)) nextScene = new MirrorScene();
+            } else if (glfwGetKey(window.ptr, GLFW_KEY_4) == GLFW_PRESS) {
+                if (!dynamic_cast<DarkScene*>(currentScene)) nextScene = new DarkScene();
+            } else if (glfwGetKey(window.ptr, GLFW_KEY_5) == GLFW_PRESS) {
+                if (!dynamic_cast<SeaScene*>(currentScene)) nextScene = new SeaScene();
+            } else if (glfwGetKey(window.ptr, GLFW_KEY_6) == GLFW_PRESS) {
+                if (!dynamic_cast<SolverStressScene*>(currentScene)) nextScene = new SolverStressScene();
             }
-            if (glfwGetKey(window.ptr, GLFW_KEY_4) == GLFW_PRESS) {
-                if (!dynamic_cast<DarkScene*>(currentScene)) {
-                    delete currentScene;
-                    currentScene = new DarkScene();
-                }
+            if (nextScene) {
+                physics.stop();
+                delete currentScene;
+                currentScene = nextScene;
+                physics.start(currentScene);
             }
-            if (glfwGetKey(window.ptr, GLFW_KEY_5) == GLFW_PRESS) {
-                if (!dynamic_cast<SeaScene*>(currentScene)) {
-                    delete currentScene;
-                    currentScene = new SeaScene();
-                }
-            }
-
-            // Physics update loop
-            float fixedTimeStep = 0.003f; 
-            timeAccumulator += std::min(deltaTime, 0.1f);
-            while (timeAccumulator >= fixedTimeStep) {
-                double physStart = glfwGetTime();
-                currentScene->step(fixedTimeStep);
-                double physEnd = glfwGetTime();
-                totalPhysTime += (physEnd - physStart);
 
-                timeAccumulator -= fixedTimeStep;
+            {
+                std::lock_guard<std::mutex> lock(physics.sceneMutex());
+                window.processInput(*currentScene, deltaTime);
+                currentScene->prepareRender();
             }
 
+            const PhysicsSnapshot& snapshot = physics.latestSnapshot();
             renderer.resize(window.width, window.height);
-            double rtPrepTime = renderer.render(*currentScene, window.getViewMatrix(), window.getProjectionMatrix(), window.cameraPos, window.raytracingMode, window.wireframeMode);
+            double rtPrepTime;
+            if (window.raytracingMode) {
+                // The ray tracer reads the meshes' vertices, which scenes may animate while stepping
+                std::lock_guard<std::mutex> lock(physics.sceneMutex());
+                rtPrepTime = renderer.render(*currentScene, snapshot, window.getViewMatrix(), window.getProjectionMatrix(), window.cameraPos, true, window.wireframeMode);
+            } else {
+                rtPrepTime = renderer.render(*currentScene, snapshot, window.getViewMatrix(), window.getProjectionMatrix(), window.cameraPos, false, window.wireframeMode);
+            }
 
             window.update();
             
@@ -104,15 +99,16 @@ int main()
 
             if (currentFrame - lastTime >= 1.0) { 
                 char title[256];
-                sprintf(title, "Raytracer | FPS: %d | Phys: %.2fms | RTPrep: %.2fms", 
-                        frameCount, totalPhysTime * 1000.0, rtPrepTime * 1000.0);
+                sprintf(title, "Raytracer | FPS: %d | Phys: %.2fms/step x%.2f | RTPrep: %.2fms | Bodies: %d awake, %d asleep | Iter: %d", 
+                        frameCount, snapshot.stepMs, snapshot.timeScale, rtPrepTime * 1000.0,
+                        snapshot.awake, snapshot.asleep, snapshot.iterations);
                 glfwSetWindowTitle(window.ptr, title);
                 frameCount = 0;
                 lastTime = currentFrame;
-                totalPhysTime = 0.0; // Reset the accumulator for the next second
             }
         }
 
+        physics.stop();
         delete currentScene;
     }
 
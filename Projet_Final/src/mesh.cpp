@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include "convexhull.h"
 #include <map>
 #include <algorithm>
 #include <cfloat>
@@ -6,6 +7,8 @@
 #include <fstream>
 #include <sstream>
 
+bool Mesh::uploadToGPU = true;
+
 // Constructor: create mesh from vertex and index data
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices)
     : vertices(vertices), indices(indices), VAO(0), VBO(0), EBO(0)
@@ -16,6 +19,10 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices)
 // Initialize GPU buffers and configure vertex attributes
 void Mesh::setupMesh()
 {
+    // Every geometry change ends here, so the cached hull is stale
+    convexHull.reset();
+    if (!uploadToGPU) return;
+
     if (VAO != 0) glDeleteVertexArrays(1, &VAO);
     if (VBO != 0) glDeleteBuffers(1, &VBO);
     if (EBO != 0) glDeleteBuffers(1, &EBO);
@@ -51,9 +58,21 @@ void Mesh::setupMesh()
     glBindVertexArray(0);
 }
 
+std::shared_ptr<const ConvexHull> Mesh::getConvexHull()
+{
+    if (!convexHull) {
+        std::vector<glm::vec3> points;
+        points.reserve(vertices.size());
+        for (const auto& v : vertices) points.push_back(v.position);
+        convexHull = std::make_shared<const ConvexHull>(buildConvexHull(points));
+    }
+    return convexHull;
+}
+
 // Render the mesh
 void Mesh::draw()
 {
+    if (VAO == 0) return;
     glBindVertexArray(VAO);
     glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
@@ -62,6 +81,7 @@ void Mesh::draw()
 // Release GPU resources
 void Mesh::cleanup()
 {
+    if (VAO == 0) return;
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
@@ -69,6 +89,7 @@ void Mesh::cleanup()
 
 void Mesh::updateBuffers()
 {
+    if (VAO == 0) return;
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), &vertices[0]);
 
@@ -0,0 +1,106 @@
+#include "meshcollider.h"
+#include "mesh.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+// Triangles per leaf
+static const int leafSize = 4;
+
+TriangleMeshCollider::TriangleMeshCollider(const Mesh& mesh, const glm::mat4& model) {
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        Triangle tri;
+        glm::vec3 vertexNormals(0.0f);
+        for (int k = 0; k < 3; ++k) {
+            const Vertex& v = mesh.vertices[mesh.indices[i + k]];
+            tri.v[k] = glm::vec3(model * glm::vec4(v.position, 1.0f));
+            vertexNormals += normalMatrix * v.normal;
+        }
+        glm::vec3 n = glm::cross(tri.v[1] - tri.v[0], tri.v[2] - tri.v[0]);
+        float len = glm::length(n);
+        if (len < 1e-12f) continue;     // Degenerate triangles never hold a contact
+        tri.normal = n / len;
+        if (glm::dot(tri.normal, vertexNormals) < 0.0f) tri.normal = -tri.normal;
+        tri.flatEdges = 0;
+        triangles.push_back(tri);
+    }
+    findFlatEdges();
+
+    // Median split build over the triangle boxes, then triangles are stored in leaf order
+    std::vector<int> order(triangles.size());
+    std::vector<AABB> boxes(triangles.size());
+    for (int i = 0; i < (int)triangles.size(); ++i) {
+        order[i] = i;
+        const Triangle& t = triangles[i];
+        boxes[i] = {glm::min(t.v[0], glm::min(t.v[1], t.v[2])), glm::max(t.v[0], glm::max(t.v[1], t.v[2]))};
+    }
+    if (triangles.empty()) return;
+    nodes.reserve(2 * triangles.size() / leafSize + 1);
+    build(order, boxes, 0, (int)order.size(), 0);
+
+    std::vector<Triangle> sorted(triangles.size());
+    for (int i = 0; i < (int)order.size(); ++i) sorted[i] = triangles[order[i]];
+    triangles.swap(sorted);
+}
+
+int TriangleMeshCollider::build(std::vector<int>& order, std::vector<AABB>& boxes, int begin, int end, int depth) {
+    int index = (int)nodes.size();
+    nodes.push_back({boxes[order[begin]], begin, 0});
+    glm::vec3 centerMin(1e30f), centerMax(-1e30f);
+    for (int i = begin; i < end; ++i) {
+        nodes[index].box = AABB::merge(nodes[index].box, boxes[order[i]]);
+        glm::vec3 c = (boxes[order[i]].min + boxes[order[i]].max) * 0.5f;
+        centerMin = glm::min(centerMin, c);
+        centerMax = glm::max(centerMax, c);
+    }
+
+    if (end - begin <= leafSize || depth >= meshColliderMaxDepth - 2) {
+        nodes[index].count = end - begin;
+        return index;
+    }
+
+    // Split at the median along the axis where the triangle centers spread the most
+    glm::vec3 extent = centerMax - centerMin;
+    int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+    int mid = (begin + end) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b) {
+        return boxes[a].min[axis] + boxes[a].max[axis] < boxes[b].min[axis] + boxes[b].max[axis];
+    });
+
+    build(order, boxes, begin, mid, depth + 1);
+    int right = build(order, boxes, mid, end, depth + 1);
+    nodes[index].first = right;
+    return index;
+}
+
+// Contacts on an edge between two coplanar triangles (or in a valley) must push along the face
+// normal, or bodies sliding across the mesh catch on edges that are not really there
+void TriangleMeshCollider::findFlatEdges() {
+    // Welded edge -> first triangle and edge slot seen; vertices are matched by exact position
+    typedef std::tuple<float, float, float> Key;
+    std::map<std::pair<Key, Key>, std::pair<int, int>> edges;
+    auto key = [](const glm::vec3& p) { return Key(p.x, p.y, p.z); };
+
+    for (int t = 0; t < (int)triangles.size(); ++t) {
+        for (int k = 0; k < 3; ++k) {
+            Key a = key(triangles[t].v[k]), b = key(triangles[t].v[(k + 1) % 3]);
+            auto edgeKey = (a < b) ? std::make_pair(a, b) : std::make_pair(b, a);
+            auto it = edges.find(edgeKey);
+            if (it == edges.end()) {
+                edges[edgeKey] = {t, k};
+                continue;
+            }
+
+            Triangle& t0 = triangles[it->second.first];
+            Triangle& t1 = triangles[t];
+            glm::vec3 far1 = t1.v[(k + 2) % 3];
+            bool coplanar = glm::dot(t0.normal, t1.normal) > 0.999f;
+            bool concave = glm::dot(t0.normal, far1 - t0.v[it->second.second]) > 0.0f;
+            if (coplanar || concave) {
+                t0.flatEdges |= 1 << it->second.second;
+                t1.flatEdges |= 1 << k;
+            }
+        }
+    }
+}
@@ -0,0 +1,863 @@
+#include "narrowphase.h"
+#include "object.h"
+#include "convexhull.h"
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/norm.hpp>
+#include <algorithm>
+#include <cfloat>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+OBB getOBB(const Object* obj) {
+    OBB obb;
+    obb.center = obj->position;
+    glm::mat3 R = glm::toMat3(obj->orientation);
+    obb.axes[0] = R[0]; obb.axes[1] = R[1]; obb.axes[2] = R[2];
+    obb.halfExtents = obj->scale * 0.5f;
+    return obb;
+}
+
+void OBBBatch::set(int lane, const OBB& obb) {
+    for (int c = 0; c < 3; ++c) {
+        center[c][lane] = obb.center[c];
+        halfExtents[c][lane] = obb.halfExtents[c];
+        for (int i = 0; i < 3; ++i) axes[i][c][lane] = obb.axes[i][c];
+    }
+}
+
+// Added to |R| so near-parallel edges never give a false separating axis
+static const float satEpsilon = 1e-5f;
+
+#ifdef __AVX2__
+
+// The 15 axes are tested in A's frame (R = A^T B, t = A^T (cB - cA)), so edge axes need no
+// normalization. Lanes keep going until every one of them has found a separating axis.
+int overlapOBB8(const OBBBatch& a, const OBBBatch& b) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 eps = _mm256_set1_ps(satEpsilon);
+    auto abs = [&](__m256 x) { return _mm256_andnot_ps(signMask, x); };
+    auto load = [](const float* p) { return _mm256_load_ps(p); };
+
+    __m256 d[3], hA[3], hB[3], A[3][3], B[3][3];
+    for (int c = 0; c < 3; ++c) {
+        d[c] = _mm256_sub_ps(load(b.center[c]), load(a.center[c]));
+        hA[c] = load(a.halfExtents[c]);
+        hB[c] = load(b.halfExtents[c]);
+        for (int i = 0; i < 3; ++i) {
+            A[i][c] = load(a.axes[i][c]);
+            B[i][c] = load(b.axes[i][c]);
+        }
+    }
+    auto dot = [](const __m256* u, const __m256* v) {
+        return _mm256_fmadd_ps(u[0], v[0], _mm256_fmadd_ps(u[1], v[1], _mm256_mul_ps(u[2], v[2])));
+    };
+
+    __m256 R[3][3], absR[3][3], t[3];
+    for (int i = 0; i < 3; ++i) {
+        t[i] = dot(A[i], d);
+        for (int j = 0; j < 3; ++j) {
+            R[i][j] = dot(A[i], B[j]);
+            absR[i][j] = _mm256_add_ps(abs(R[i][j]), eps);
+        }
+    }
+
+    __m256 separated = _mm256_setzero_ps();
+    auto test = [&](__m256 dist, __m256 radius) {
+        separated = _mm256_or_ps(separated, _mm256_cmp_ps(abs(dist), radius, _CMP_GT_OQ));
+    };
+
+    // Face axes of A and B
+    for (int i = 0; i < 3; ++i) {
+        __m256 rb = _mm256_fmadd_ps(hB[0], absR[i][0], _mm256_fmadd_ps(hB[1], absR[i][1], _mm256_mul_ps(hB[2], absR[i][2])));
+        test(t[i], _mm256_add_ps(hA[i], rb));
+    }
+    for (int j = 0; j < 3; ++j) {
+        __m256 ra = _mm256_fmadd_ps(hA[0], absR[0][j], _mm256_fmadd_ps(hA[1], absR[1][j], _mm256_mul_ps(hA[2], absR[2][j])));
+        __m256 dist = _mm256_fmadd_ps(t[0], R[0][j], _mm256_fmadd_ps(t[1], R[1][j], _mm256_mul_ps(t[2], R[2][j])));
+        test(dist, _mm256_add_ps(ra, hB[j]));
+    }
+    if (_mm256_movemask_ps(separated) == 0xFF) return 0;
+
+    // Edge axes A_i x B_j
+    for (int i = 0; i < 3; ++i) {
+        int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for (int j = 0; j < 3; ++j) {
+            int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            __m256 ra = _mm256_fmadd_ps(hA[i1], absR[i2][j], _mm256_mul_ps(hA[i2], absR[i1][j]));
+            __m256 rb = _mm256_fmadd_ps(hB[j1], absR[i][j2], _mm256_mul_ps(hB[j2], absR[i][j1]));
+            __m256 dist = _mm256_fmsub_ps(t[i2], R[i1][j], _mm256_mul_ps(t[i1], R[i2][j]));
+            test(dist, _mm256_add_ps(ra, rb));
+        }
+        if (_mm256_movemask_ps(separated) == 0xFF) return 0;
+    }
+
+    return ~_mm256_movemask_ps(separated) & 0xFF;
+}
+
+#else
+
+// Scalar fallback, same tests lane by lane
+int overlapOBB8(const OBBBatch& a, const OBBBatch& b) {
+    int mask = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+        float d[3], hA[3], hB[3], R[3][3], absR[3][3], t[3];
+        for (int c = 0; c < 3; ++c) {
+            d[c] = b.center[c][lane] - a.center[c][lane];
+            hA[c] = a.halfExtents[c][lane];
+            hB[c] = b.halfExtents[c][lane];
+        }
+        for (int i = 0; i < 3; ++i) {
+            t[i] = a.axes[i][0][lane] * d[0] + a.axes[i][1][lane] * d[1] + a.axes[i][2][lane] * d[2];
+            for (int j = 0; j < 3; ++j) {
+                R[i][j] = a.axes[i][0][lane] * b.axes[j][0][lane] + a.axes[i][1][lane] * b.axes[j][1][lane] + a.axes[i][2][lane] * b.axes[j][2][lane];
+                absR[i][j] = std::abs(R[i][j]) + satEpsilon;
+            }
+        }
+
+        auto separated = [&]() {
+            for (int i = 0; i < 3; ++i) {
+                if (std::abs(t[i]) > hA[i] + hB[0] * absR[i][0] + hB[1] * absR[i][1] + hB[2] * absR[i][2]) return true;
+            }
+            for (int j = 0; j < 3; ++j) {
+                float dist = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+                if (std::abs(dist) > hA[0] * absR[0][j] + hA[1] * absR[1][j] + hA[2] * absR[2][j] + hB[j]) return true;
+            }
+            for (int i = 0; i < 3; ++i) {
+                int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+                for (int j = 0; j < 3; ++j) {
+                    int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                    float ra = hA[i1] * absR[i2][j] + hA[i2] * absR[i1][j];
+                    float rb = hB[j1] * absR[i][j2] + hB[j2] * absR[i][j1];
+                    if (std::abs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb) return true;
+                }
+            }
+            return false;
+        };
+        if (!separated()) mask |= 1 << lane;
+    }
+    return mask;
+}
+
+#endif
+
+// Half length of the box's shadow on a unit axis
+static float projectRadius(const OBB& o, const glm::vec3& axis) {
+    return o.halfExtents.x * std::abs(glm::dot(axis, o.axes[0])) +
+           o.halfExtents.y * std::abs(glm::dot(axis, o.axes[1])) +
+           o.halfExtents.z * std::abs(glm::dot(axis, o.axes[2]));
+}
+
+// [Sutherland-Hodgman] Keeps the part of the polygon where dot(planeNormal, p) <= offset
+static int clipPolygon(const glm::vec3* in, int count, const glm::vec3& planeNormal, float offset, glm::vec3* out) {
+    int outCount = 0;
+    if (count == 0) return 0;
+    for (int i = 0; i < count; ++i) {
+        const glm::vec3& p = in[i];
+        const glm::vec3& q = in[(i + 1) % count];
+        float dp = glm::dot(planeNormal, p) - offset;
+        float dq = glm::dot(planeNormal, q) - offset;
+        if (dp <= 0.0f) out[outCount++] = p;
+        if ((dp < 0.0f && dq > 0.0f) || (dp > 0.0f && dq < 0.0f)) {
+            out[outCount++] = p + (q - p) * (dp / (dp - dq));
+        }
+    }
+    return outCount;
+}
+
+int reduceManifold(const ContactPoint* points, int count, const glm::vec3& normal, ContactPoint out[maxManifoldPoints]) {
+    if (count <= maxManifoldPoints) {
+        std::copy(points, points + count, out);
+        return count;
+    }
+
+    int deepest = 0;
+    for (int i = 1; i < count; ++i) {
+        if (points[i].penetration > points[deepest].penetration) deepest = i;
+    }
+
+    int farthest = -1;
+    float bestDistSq = -1.0f;
+    for (int i = 0; i < count; ++i) {
+        float distSq = glm::distance2(points[i].position, points[deepest].position);
+        if (distSq > bestDistSq) { bestDistSq = distSq; farthest = i; }
+    }
+
+    // Signed areas of the triangles built on the deepest-farthest segment, seen along the normal
+    glm::vec3 edge = points[farthest].position - points[deepest].position;
+    int left = -1, right = -1;
+    float maxArea = 0.0f, minArea = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        float area = glm::dot(glm::cross(edge, points[i].position - points[deepest].position), normal);
+        if (area > maxArea) { maxArea = area; left = i; }
+        if (area < minArea) { minArea = area; right = i; }
+    }
+
+    int outCount = 0;
+    out[outCount++] = points[deepest];
+    if (farthest != deepest) out[outCount++] = points[farthest];
+    if (left >= 0) out[outCount++] = points[left];
+    if (right >= 0) out[outCount++] = points[right];
+    return outCount;
+}
+
+int collideBoxBox(const OBB& A, const OBB& B, glm::vec3& normal, float& depth, ContactPoint out[maxManifoldPoints]) {
+    glm::vec3 d = B.center - A.center;
+
+    // Face axes of A then B
+    float faceDepth = FLT_MAX;
+    int faceAxis = -1;
+    glm::vec3 faceNormal(0.0f);
+    for (int i = 0; i < 6; ++i) {
+        const glm::vec3& axis = (i < 3) ? A.axes[i] : B.axes[i - 3];
+        float dist = glm::dot(d, axis);
+        float overlap = projectRadius(A, axis) + projectRadius(B, axis) - std::abs(dist);
+        if (overlap < 0.0f) return 0;
+        if (overlap < faceDepth) {
+            faceDepth = overlap;
+            faceAxis = i;
+            faceNormal = (dist > 0.0f) ? -axis : axis;
+        }
+    }
+
+    // Edge-edge axes, skipped when the two edges are parallel
+    float edgeDepth = FLT_MAX;
+    int edgeAxis = -1;
+    glm::vec3 edgeNormal(0.0f);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            glm::vec3 axis = glm::cross(A.axes[i], B.axes[j]);
+            float len = glm::length(axis);
+            if (len < 0.001f) continue;
+            axis /= len;
+            float dist = glm::dot(d, axis);
+            float overlap = projectRadius(A, axis) + projectRadius(B, axis) - std::abs(dist);
+            if (overlap < 0.0f) return 0;
+            if (overlap < edgeDepth) {
+                edgeDepth = overlap;
+                edgeAxis = i * 3 + j;
+                edgeNormal = (dist > 0.0f) ? -axis : axis;
+            }
+        }
+    }
+
+    // Faces are preferred unless an edge axis is clearly shallower, so resting manifolds don't flicker
+    if (edgeAxis >= 0 && edgeDepth < 0.95f * faceDepth - 0.01f) {
+        int i = edgeAxis / 3, j = edgeAxis % 3;
+        normal = edgeNormal;
+        depth = edgeDepth;
+
+        // Edge of A closest to B, and edge of B closest to A
+        glm::vec3 pA = A.center, pB = B.center;
+        for (int k = 0; k < 3; ++k) {
+            if (k != i) pA += A.axes[k] * (glm::dot(A.axes[k], -normal) > 0.0f ? A.halfExtents[k] : -A.halfExtents[k]);
+            if (k != j) pB += B.axes[k] * (glm::dot(B.axes[k], normal) > 0.0f ? B.halfExtents[k] : -B.halfExtents[k]);
+        }
+
+        // Closest points of the two segments
+        const glm::vec3& dA = A.axes[i];
+        const glm::vec3& dB = B.axes[j];
+        glm::vec3 r = pA - pB;
+        float b = glm::dot(dA, dB), c = glm::dot(dA, r), f = glm::dot(dB, r);
+        float denom = 1.0f - b * b;
+        float s = (denom > 1e-6f) ? (b * f - c) / denom : 0.0f;
+        s = glm::clamp(s, -A.halfExtents[i], A.halfExtents[i]);
+        float t = glm::clamp(b * s + f, -B.halfExtents[j], B.halfExtents[j]);
+        s = glm::clamp(b * t - c, -A.halfExtents[i], A.halfExtents[i]);
+
+        out[0] = {0.5f * (pA + dA * s + pB + dB * t), edgeDepth, -1};
+        return 1;
+    }
+
+    normal = faceNormal;
+    depth = faceDepth;
+
+    // Reference face on the box owning the axis, facing the other (incident) box
+    bool refIsA = faceAxis < 3;
+    const OBB& ref = refIsA ? A : B;
+    const OBB& inc = refIsA ? B : A;
+    int ri = faceAxis % 3;
+    glm::vec3 refNormal = refIsA ? -normal : normal;
+
+    // Incident face: the face of the other box most opposed to the reference normal
+    int ii = 0;
+    float bestDot = -1.0f;
+    for (int k = 0; k < 3; ++k) {
+        float dotK = std::abs(glm::dot(inc.axes[k], refNormal));
+        if (dotK > bestDot) { bestDot = dotK; ii = k; }
+    }
+    glm::vec3 incNormal = (glm::dot(inc.axes[ii], refNormal) > 0.0f) ? -inc.axes[ii] : inc.axes[ii];
+    glm::vec3 incCenter = inc.center + incNormal * inc.halfExtents[ii];
+    glm::vec3 du = inc.axes[(ii + 1) % 3] * inc.halfExtents[(ii + 1) % 3];
+    glm::vec3 dv = inc.axes[(ii + 2) % 3] * inc.halfExtents[(ii + 2) % 3];
+
+    // A quad clipped by 4 planes has at most 8 vertices
+    glm::vec3 polyA[8] = {incCenter + du + dv, incCenter - du + dv, incCenter - du - dv, incCenter + du - dv};
+    glm::vec3 polyB[8];
+    int count = 4;
+    for (int side = 1; side <= 2; ++side) {
+        int k = (ri + side) % 3;
+        float centerDist = glm::dot(ref.axes[k], ref.center);
+        count = clipPolygon(polyA, count, ref.axes[k], centerDist + ref.halfExtents[k], polyB);
+        count = clipPolygon(polyB, count, -ref.axes[k], -centerDist + ref.halfExtents[k], polyA);
+    }
+
+    // Keep clipped points below the reference face, placed halfway between the two surfaces
+    float refOffset = glm::dot(refNormal, ref.center) + ref.halfExtents[ri];
+    ContactPoint points[8];
+    int pointCount = 0;
+    for (int k = 0; k < count; ++k) {
+        float separation = glm::dot(refNormal, polyA[k]) - refOffset;
+        if (separation > 0.0f) continue;
+        points[pointCount++] = {polyA[k] - 0.5f * separation * refNormal, -separation, -1};
+    }
+
+    // Degenerate clip: fall back to a single contact between the centers
+    if (pointCount == 0) {
+        out[0] = {(A.center + B.center) * 0.5f, faceDepth, -1};
+        return 1;
+    }
+    return reduceManifold(points, pointCount, normal, out);
+}
+
+int collideBoxPlane(const OBB& box, const glm::vec3& normal, float offset, ContactPoint out[maxManifoldPoints]) {
+    if (glm::dot(normal, box.center) - projectRadius(box, normal) >= offset) return 0;
+
+    ContactPoint points[8];
+    int count = 0;
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 p = box.center
+            + box.axes[0] * ((corner & 1) ? box.halfExtents.x : -box.halfExtents.x)
+            + box.axes[1] * ((corner & 2) ? box.halfExtents.y : -box.halfExtents.y)
+            + box.axes[2] * ((corner & 4) ? box.halfExtents.z : -box.halfExtents.z);
+        float separation = glm::dot(normal, p) - offset;
+        if (separation < 0.0f) points[count++] = {p, -separation, corner};
+    }
+    return reduceManifold(points, count, normal, out);
+}
+
+ConvexShape getConvexShape(const Object* obj) {
+    ConvexShape shape;
+    shape.center = obj->position;
+    shape.rotation = glm::toMat3(obj->orientation);
+    if (obj->collisionRadius > 0.0f) {
+        shape.type = ConvexShape::Sphere;
+        shape.scale = glm::vec3(0.0f);
+        shape.radius = obj->collisionRadius;
+    } else if (obj->isConvexHull) {
+        shape.type = ConvexShape::Hull;
+        shape.hull = obj->convexHull.get();
+        shape.scale = obj->scale;
+    } else {
+        shape.type = ConvexShape::Box;
+        shape.scale = obj->scale * 0.5f;
+    }
+    return shape;
+}
+
+ConvexShape getTriangleShape(const glm::vec3 corners[3]) {
+    ConvexShape shape;
+    shape.type = ConvexShape::Triangle;
+    shape.corners = corners;
+    shape.center = (corners[0] + corners[1] + corners[2]) / 3.0f;
+    shape.rotation = glm::mat3(1.0f);
+    shape.scale = glm::vec3(1.0f);
+    return shape;
+}
+
+glm::vec3 ConvexShape::support(const glm::vec3& dir) const {
+    if (type == Sphere) return center;
+    if (type == Triangle) {
+        float d0 = glm::dot(corners[0], dir), d1 = glm::dot(corners[1], dir), d2 = glm::dot(corners[2], dir);
+        return (d0 >= d1 && d0 >= d2) ? corners[0] : (d1 >= d2 ? corners[1] : corners[2]);
+    }
+    glm::vec3 local = glm::transpose(rotation) * dir;
+    if (type == Box) {
+        return center + rotation * glm::vec3(local.x >= 0.0f ? scale.x : -scale.x,
+                                             local.y >= 0.0f ? scale.y : -scale.y,
+                                             local.z >= 0.0f ? scale.z : -scale.z);
+    }
+    // The farthest scaled vertex along d is the farthest unscaled one along scale * d
+    return center + rotation * (hull->vertices[hull->support(local * scale)] * scale);
+}
+
+int ConvexShape::vertexCount() const {
+    if (type == Sphere) return 1;
+    if (type == Triangle) return 3;
+    if (type == Box) return 8;
+    return (int)hull->vertices.size();
+}
+
+glm::vec3 ConvexShape::vertex(int i) const {
+    if (type == Sphere) return center;
+    if (type == Triangle) return corners[i];
+    if (type == Box) {
+        return center + rotation * glm::vec3((i & 1) ? scale.x : -scale.x, (i & 2) ? scale.y : -scale.y, (i & 4) ? scale.z : -scale.z);
+    }
+    return center + rotation * (hull->vertices[i] * scale);
+}
+
+// Sorts the corners of a planar convex polygon counter-clockwise around normal
+static void sortAroundNormal(glm::vec3* corners, int count, const glm::vec3& normal) {
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < count; ++i) center += corners[i];
+    center /= (float)count;
+    glm::vec3 u = glm::normalize(corners[0] - center), v = glm::cross(normal, u);
+    std::sort(corners, corners + count, [&](const glm::vec3& p, const glm::vec3& q) {
+        return std::atan2(glm::dot(p - center, v), glm::dot(p - center, u)) < std::atan2(glm::dot(q - center, v), glm::dot(q - center, u));
+    });
+}
+
+int ConvexShape::supportFace(const glm::vec3& dir, float cosLimit, glm::vec3 face[maxFaceVertices], glm::vec3& faceNormal) const {
+    if (type == Sphere) return 0;
+    if (type == Triangle) {
+        // Both sides are faces; the corners are flipped on the back so they stay counter-clockwise
+        glm::vec3 n = glm::normalize(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+        float d = glm::dot(n, dir);
+        if (std::abs(d) < cosLimit) return 0;
+        faceNormal = (d > 0.0f) ? n : -n;
+        face[0] = corners[0];
+        face[1] = corners[d > 0.0f ? 1 : 2];
+        face[2] = corners[d > 0.0f ? 2 : 1];
+        return 3;
+    }
+    glm::vec3 local = glm::transpose(rotation) * dir;
+
+    if (type == Box) {
+        int k = 0;
+        for (int i = 1; i < 3; ++i) {
+            if (std::abs(local[i]) > std::abs(local[k])) k = i;
+        }
+        if (std::abs(local[k]) < cosLimit) return 0;
+        float side = (local[k] > 0.0f) ? 1.0f : -1.0f;
+        faceNormal = rotation[k] * side;
+        glm::vec3 c = center + faceNormal * scale[k];
+        glm::vec3 u = rotation[(k + 1) % 3] * scale[(k + 1) % 3];
+        glm::vec3 v = rotation[(k + 2) % 3] * scale[(k + 2) % 3] * side;
+        face[0] = c + u + v; face[1] = c - u + v; face[2] = c - u - v; face[3] = c + u - v;
+        return 4;
+    }
+
+    if (!hull->hasFaces()) return 0;
+    int best = -1;
+    float bestDot = cosLimit;
+    for (int i = 0; i < (int)hull->planes.size(); ++i) {
+        float d = glm::dot(glm::normalize(glm::vec3(hull->planes[i]) / scale), local);
+        if (d >= bestDot) { bestDot = d; best = i; }
+    }
+    if (best < 0) return 0;
+
+    // Every vertex on the plane of that triangle: coplanar triangles make up the whole face
+    const glm::vec4& plane = hull->planes[best];
+    glm::vec3 scaledNormal = glm::vec3(plane) / scale;
+    float tolerance = 1e-3f * boundingRadius() * glm::length(scaledNormal);
+    glm::vec3 onFace[64];
+    int count = 0;
+    for (const auto& vertex : hull->vertices) {
+        if (std::abs(glm::dot(glm::vec3(plane), vertex) - plane.w) > tolerance) continue;
+        onFace[count++] = center + rotation * (vertex * scale);
+        if (count == 64) break;
+    }
+    faceNormal = glm::normalize(rotation * scaledNormal);
+    sortAroundNormal(onFace, count, faceNormal);
+    int stride = (count + maxFaceVertices - 1) / maxFaceVertices;
+    int outCount = 0;
+    for (int i = 0; i < count; i += stride) face[outCount++] = onFace[i];
+    return outCount;
+}
+
+float ConvexShape::boundingRadius() const {
+    if (type == Sphere) return 0.0f;
+    if (type == Triangle) {
+        return std::sqrt(std::max(glm::distance2(corners[0], center), std::max(glm::distance2(corners[1], center), glm::distance2(corners[2], center))));
+    }
+    if (type == Box) return glm::length(scale);
+    return hull->radius * std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+}
+
+namespace {
+
+// Point of the Minkowski difference A - B, with the support points it comes from
+struct SupportVertex {
+    glm::vec3 w, a, b;
+};
+
+SupportVertex supportDifference(const ConvexShape& A, const ConvexShape& B, const glm::vec3& dir) {
+    SupportVertex v;
+    v.a = A.support(dir);
+    v.b = B.support(-dir);
+    v.w = v.a - v.b;
+    return v;
+}
+
+// Up to 4 vertices, with the barycentric weights of the simplex point closest to the origin
+struct Simplex {
+    SupportVertex v[4];
+    float weight[4];
+    int count = 0;
+
+    void keep1(int i) {
+        v[0] = v[i];
+        weight[0] = 1.0f;
+        count = 1;
+    }
+    void keep2(int i, int j, float t) {
+        SupportVertex vi = v[i], vj = v[j];
+        v[0] = vi; v[1] = vj;
+        weight[0] = 1.0f - t; weight[1] = t;
+        count = 2;
+    }
+    glm::vec3 point() const {
+        glm::vec3 p(0.0f);
+        for (int i = 0; i < count; ++i) p += weight[i] * v[i].w;
+        return p;
+    }
+};
+
+const int gjkMaxIterations = 32;
+const float gjkTolerance = 1e-4f;      // Relative progress under which GJK stops
+const int epaMaxVertices = 64;
+const int epaMaxFaces = 128;
+const float epaTolerance = 1e-4f;
+
+glm::vec3 closestOnSegment(Simplex& s) {
+    glm::vec3 a = s.v[0].w, ab = s.v[1].w - s.v[0].w;
+    float t = -glm::dot(a, ab);
+    if (t <= 0.0f) { s.keep1(0); return a; }
+    float denom = glm::dot(ab, ab);
+    if (t >= denom) { s.keep1(1); return s.v[0].w; }
+    s.keep2(0, 1, t / denom);
+    return s.point();
+}
+
+// [Ericson 5.1.5] Voronoi regions of the triangle, tested from the vertices to the face
+glm::vec3 closestOnTriangle(Simplex& s) {
+    glm::vec3 a = s.v[0].w, b = s.v[1].w, c = s.v[2].w;
+    glm::vec3 ab = b - a, ac = c - a;
+    float d1 = glm::dot(ab, -a), d2 = glm::dot(ac, -a);
+    if (d1 <= 0.0f && d2 <= 0.0f) { s.keep1(0); return s.point(); }
+
+    float d3 = glm::dot(ab, -b), d4 = glm::dot(ac, -b);
+    if (d3 >= 0.0f && d4 <= d3) { s.keep1(1); return s.point(); }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) { s.keep2(0, 1, d1 / (d1 - d3)); return s.point(); }
+
+    float d5 = glm::dot(ab, -c), d6 = glm::dot(ac, -c);
+    if (d6 >= 0.0f && d5 <= d6) { s.keep1(2); return s.point(); }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) { s.keep2(0, 2, d2 / (d2 - d6)); return s.point(); }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        s.keep2(1, 2, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return s.point();
+    }
+
+    float denom = va + vb + vc;
+    if (denom <= 0.0f) { s.keep1(0); return s.point(); }    // Degenerate triangle
+    s.weight[1] = vb / denom;
+    s.weight[2] = vc / denom;
+    s.weight[0] = 1.0f - s.weight[1] - s.weight[2];
+    s.count = 3;
+    return s.point();
+}
+
+// Closest point over the faces that separate the origin from the opposite vertex. Returns false
+// when the origin is inside the tetrahedron.
+bool closestOnTetrahedron(Simplex& s, glm::vec3& closest) {
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    Simplex best;
+    float bestDistSq = FLT_MAX;
+    for (const auto& f : faces) {
+        glm::vec3 a = s.v[f[0]].w;
+        glm::vec3 n = glm::cross(s.v[f[1]].w - a, s.v[f[2]].w - a);
+        float originSide = glm::dot(n, -a), oppositeSide = glm::dot(n, s.v[f[3]].w - a);
+        if (originSide * oppositeSide > 0.0f) continue;
+
+        Simplex face;
+        face.v[0] = s.v[f[0]]; face.v[1] = s.v[f[1]]; face.v[2] = s.v[f[2]];
+        face.count = 3;
+        glm::vec3 p = closestOnTriangle(face);
+        float distSq = glm::length2(p);
+        if (distSq < bestDistSq) { bestDistSq = distSq; best = face; closest = p; }
+    }
+    if (bestDistSq == FLT_MAX) return false;
+    s = best;
+    return true;
+}
+
+// Returns false when the cores overlap; s then holds the simplex enclosing (or touching) the origin
+bool gjk(const ConvexShape& A, const ConvexShape& B, Simplex& s, glm::vec3& v) {
+    v = A.center - B.center;
+    if (glm::length2(v) < 1e-12f) v = glm::vec3(1.0f, 0.0f, 0.0f);
+    s.count = 0;
+    for (int iteration = 0; iteration < gjkMaxIterations; ++iteration) {
+        SupportVertex p = supportDifference(A, B, -v);
+        float vv = glm::dot(v, v);
+        if (s.count > 0 && vv - glm::dot(v, p.w) <= gjkTolerance * vv) return true;
+
+        // A vertex already in the simplex: no closer point exists, whatever rounding says
+        for (int i = 0; i < s.count; ++i) {
+            if (glm::distance2(s.v[i].w, p.w) < 1e-12f) return true;
+        }
+
+        s.v[s.count++] = p;
+        if (s.count == 1) { s.weight[0] = 1.0f; v = p.w; }
+        else if (s.count == 2) v = closestOnSegment(s);
+        else if (s.count == 3) v = closestOnTriangle(s);
+        else if (!closestOnTetrahedron(s, v)) return false;
+
+        if (glm::length2(v) < 1e-12f) return false;
+    }
+    return true;
+}
+
+// Grows a degenerate GJK simplex into a tetrahedron, so EPA has a volume to expand
+bool completeTetrahedron(const ConvexShape& A, const ConvexShape& B, Simplex& s) {
+    const float eps = 1e-5f;
+    if (s.count == 1) {
+        static const glm::vec3 axes[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for (const auto& axis : axes) {
+            SupportVertex p = supportDifference(A, B, axis);
+            if (glm::distance(p.w, s.v[0].w) > eps) { s.v[s.count++] = p; break; }
+        }
+        if (s.count < 2) return false;
+    }
+    if (s.count == 2) {
+        glm::vec3 d = glm::normalize(s.v[1].w - s.v[0].w);
+        glm::vec3 axis = (std::abs(d.x) < 0.57f) ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        glm::vec3 u = glm::normalize(glm::cross(d, axis)), w = glm::cross(d, u);
+        for (int k = 0; k < 6 && s.count < 3; ++k) {
+            float angle = k * 1.0471976f;
+            SupportVertex p = supportDifference(A, B, std::cos(angle) * u + std::sin(angle) * w);
+            glm::vec3 r = p.w - s.v[0].w;
+            if (glm::length(r - d * glm::dot(r, d)) > eps) s.v[s.count++] = p;
+        }
+        if (s.count < 3) return false;
+    }
+    if (s.count == 3) {
+        glm::vec3 n = glm::normalize(glm::cross(s.v[1].w - s.v[0].w, s.v[2].w - s.v[0].w));
+        SupportVertex p = supportDifference(A, B, n);
+        if (std::abs(glm::dot(n, p.w - s.v[0].w)) <= eps) p = supportDifference(A, B, -n);
+        if (std::abs(glm::dot(n, p.w - s.v[0].w)) <= eps) return false;
+        s.v[s.count++] = p;
+    }
+    return true;
+}
+
+struct EpaFace {
+    int v[3];
+    glm::vec3 normal;
+    float dist;
+};
+
+// [EPA] Expands the polytope towards the face of the Minkowski difference closest to the origin.
+// Fixed-size buffers: when they fill up, the best face so far is returned.
+void epa(const ConvexShape& A, const ConvexShape& B, const Simplex& s, glm::vec3& normal, float& depth, glm::vec3& pointA, glm::vec3& pointB) {
+    SupportVertex verts[epaMaxVertices];
+    EpaFace faces[epaMaxFaces];
+    int vertCount = 4, faceCount = 0;
+    for (int i = 0; i < 4; ++i) verts[i] = s.v[i];
+
+    auto addFace = [&](int a, int b, int c) {
+        glm::vec3 n = glm::cross(verts[b].w - verts[a].w, verts[c].w - verts[a].w);
+        float len = glm::length(n);
+        if (len < 1e-12f || faceCount == epaMaxFaces) return false;
+        n /= len;
+        faces[faceCount++] = {{a, b, c}, n, glm::dot(n, verts[a].w)};
+        return true;
+    };
+
+    // Tetrahedron faces oriented away from its centroid
+    glm::vec3 centroid = (verts[0].w + verts[1].w + verts[2].w + verts[3].w) * 0.25f;
+    static const int tetra[4][3] = {{0, 1, 2}, {0, 3, 1}, {1, 3, 2}, {2, 3, 0}};
+    for (const auto& t : tetra) {
+        glm::vec3 n = glm::cross(verts[t[1]].w - verts[t[0]].w, verts[t[2]].w - verts[t[0]].w);
+        if (glm::dot(n, centroid - verts[t[0]].w) > 0.0f) addFace(t[0], t[2], t[1]);
+        else addFace(t[0], t[1], t[2]);
+    }
+
+    EpaFace best = faces[0];
+    for (;;) {
+        best = faces[0];
+        for (int f = 1; f < faceCount; ++f) {
+            if (faces[f].dist < best.dist) best = faces[f];
+        }
+        if (vertCount == epaMaxVertices) break;
+
+        SupportVertex p = supportDifference(A, B, best.normal);
+        if (glm::dot(p.w, best.normal) - best.dist < epaTolerance) break;
+
+        // Faces seen from the new vertex go; the edges they share with the rest form the horizon
+        int edges[3 * epaMaxFaces][2];
+        int edgeCount = 0;
+        int kept = 0;
+        for (int f = 0; f < faceCount; ++f) {
+            if (glm::dot(faces[f].normal, p.w - verts[faces[f].v[0]].w) <= 0.0f) {
+                faces[kept++] = faces[f];
+                continue;
+            }
+            for (int e = 0; e < 3; ++e) {
+                int a = faces[f].v[e], b = faces[f].v[(e + 1) % 3];
+                int shared = -1;
+                for (int k = 0; k < edgeCount; ++k) {
+                    if (edges[k][0] == b && edges[k][1] == a) { shared = k; break; }
+                }
+                if (shared >= 0) {
+                    edges[shared][0] = edges[edgeCount - 1][0];
+                    edges[shared][1] = edges[edgeCount - 1][1];
+                    --edgeCount;
+                } else {
+                    edges[edgeCount][0] = a;
+                    edges[edgeCount][1] = b;
+                    ++edgeCount;
+                }
+            }
+        }
+        if (kept + edgeCount > epaMaxFaces) break;
+        faceCount = kept;
+
+        // A sliver face means the polytope stopped making numerical sense: keep the best face so far
+        verts[vertCount] = p;
+        bool valid = true;
+        for (int k = 0; k < edgeCount && valid; ++k) valid = addFace(edges[k][0], edges[k][1], vertCount);
+        ++vertCount;
+        if (!valid || faceCount == 0) break;
+    }
+
+    // Barycentric coordinates of the origin's projection on the closest face give the witness points
+    const EpaFace& face = best;
+    normal = face.normal;
+    depth = face.dist;
+    glm::vec3 a = verts[face.v[0]].w, b = verts[face.v[1]].w, c = verts[face.v[2]].w;
+    glm::vec3 p = face.normal * face.dist;
+    glm::vec3 n = glm::cross(b - a, c - a);
+    float area = glm::dot(n, n);
+    float u = glm::dot(glm::cross(c - b, p - b), n) / area;
+    float v = glm::dot(glm::cross(a - c, p - c), n) / area;
+    float w = 1.0f - u - v;
+    pointA = u * verts[face.v[0]].a + v * verts[face.v[1]].a + w * verts[face.v[2]].a;
+    pointB = u * verts[face.v[0]].b + v * verts[face.v[1]].b + w * verts[face.v[2]].b;
+}
+
+}
+
+void convexDistance(const ConvexShape& A, const ConvexShape& B, glm::vec3& normal, float& distance, glm::vec3& pointA, glm::vec3& pointB) {
+    Simplex s;
+    glm::vec3 v;
+    if (gjk(A, B, s, v)) {
+        pointA = pointB = glm::vec3(0.0f);
+        for (int i = 0; i < s.count; ++i) {
+            pointA += s.weight[i] * s.v[i].a;
+            pointB += s.weight[i] * s.v[i].b;
+        }
+        distance = glm::length(v);
+        normal = v / distance;
+    } else if (completeTetrahedron(A, B, s)) {
+        glm::vec3 direction;
+        epa(A, B, s, direction, distance, pointA, pointB);
+        normal = -direction;
+        distance = -distance;
+    } else {
+        // Flat cores touching at the origin: no volume to expand, they only graze
+        normal = A.center - B.center;
+        normal = (glm::length2(normal) > 1e-12f) ? glm::normalize(normal) : glm::vec3(0.0f, 1.0f, 0.0f);
+        distance = 0.0f;
+        pointA = A.support(-normal);
+        pointB = B.support(normal);
+    }
+
+    // Rounded cores: the surfaces sit 'radius' further out along the normal
+    distance -= A.radius + B.radius;
+    pointA -= normal * A.radius;
+    pointB += normal * B.radius;
+}
+
+// A face is used for clipping when its normal is within about 11 degrees of the GJK/EPA normal
+static const float convexFaceCosLimit = 0.98f;
+// Clipped points farther than this above the deepest one are not considered touching
+static const float convexContactTolerance = 0.02f;
+
+int collideConvex(const ConvexShape& A, const ConvexShape& B, float margin, glm::vec3& normal, ContactPoint out[maxManifoldPoints]) {
+    glm::vec3 pointA, pointB;
+    float distance;
+    convexDistance(A, B, normal, distance, pointA, pointB);
+    if (distance > margin) return 0;
+
+    // Reference face: the face of B along the normal or the face of A against it, whichever is
+    // better aligned. The incident polygon is the other shape's face most opposed to it.
+    // Rounded shapes are skipped: their cores are not their surfaces.
+    glm::vec3 faceA[maxFaceVertices], faceB[maxFaceVertices], normalA, normalB;
+    bool rounded = A.radius > 0.0f || B.radius > 0.0f;
+    int countB = rounded ? 0 : B.supportFace(normal, convexFaceCosLimit, faceB, normalB);
+    int countA = rounded ? 0 : A.supportFace(-normal, convexFaceCosLimit, faceA, normalA);
+    bool refIsB = countB > 0 && (countA == 0 || glm::dot(normalB, normal) >= glm::dot(normalA, -normal));
+    if (countB > 0 || countA > 0) {
+        const ConvexShape& incShape = refIsB ? A : B;
+        glm::vec3* ref = refIsB ? faceB : faceA;
+        int refCount = refIsB ? countB : countA;
+        glm::vec3 refNormal = refIsB ? normalB : normalA;
+
+        // Incident polygon of any orientation: a single vertex or an edge when no face faces the reference
+        glm::vec3 polyA[maxFaceVertices * 3], polyB[maxFaceVertices * 3], incNormal;
+        int count = incShape.supportFace(-refNormal, -1.0f, polyA, incNormal);
+        if (count == 0) {
+            polyA[0] = incShape.support(-refNormal);
+            count = 1;
+        }
+
+        // Clip by the side planes of the reference polygon (counter-clockwise, so cross(edge, n) points out)
+        for (int k = 0; k < refCount && count > 0; ++k) {
+            const glm::vec3& p = ref[k];
+            const glm::vec3& q = ref[(k + 1) % refCount];
+            glm::vec3 side = glm::cross(q - p, refNormal);
+            float len = glm::length(side);
+            if (len < 1e-9f) continue;
+            side /= len;
+            count = clipPolygon(polyA, count, side, glm::dot(side, p), polyB);
+            std::copy(polyB, polyB + count, polyA);
+        }
+
+        float refOffset = glm::dot(refNormal, ref[0]);
+        float limit = std::min(margin, distance + convexContactTolerance);
+        ContactPoint points[maxFaceVertices * 3];
+        int pointCount = 0;
+        for (int k = 0; k < count; ++k) {
+            float separation = glm::dot(refNormal, polyA[k]) - refOffset;
+            if (separation > limit) continue;
+            points[pointCount++] = {polyA[k] - 0.5f * separation * refNormal, -separation, -1};
+        }
+        if (pointCount > 0) {
+            normal = refIsB ? refNormal : -refNormal;
+            return reduceManifold(points, pointCount, normal, out);
+        }
+    }
+
+    // Rounded shapes, edge contacts and degenerate clips: the single witness point
+    out[0] = {0.5f * (pointA + pointB), -distance, -1};
+    return 1;
+}
+
+int collideConvexPlane(const ConvexShape& shape, const glm::vec3& normal, float offset, ContactPoint out[maxManifoldPoints]) {
+    if (glm::dot(normal, shape.center) - shape.boundingRadius() >= offset) return 0;
+
+    ContactPoint points[32];
+    int count = 0;
+    for (int i = 0; i < shape.vertexCount(); ++i) {
+        glm::vec3 p = shape.vertex(i);
+        float separation = glm::dot(normal, p) - offset;
+        if (separation >= 0.0f) continue;
+        if (count < 32) {
+            points[count++] = {p, -separation, i};
+            continue;
+        }
+        int shallowest = 0;
+        for (int k = 1; k < count; ++k) {
+            if (points[k].penetration < points[shallowest].penetration) shallowest = k;
+        }
+        if (-separation > points[shallowest].penetration) points[shallowest] = {p, -separation, i};
+    }
+    return reduceManifold(points, count, normal, out);
+}
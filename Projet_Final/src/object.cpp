@@ -1,5 +1,6 @@
 #include "object.h"
 #include "shader.h"
+#include "convexhull.h"
 #include <cfloat>
 #include <iostream>
 #include <glm/gtc/quaternion.hpp>
@@ -7,6 +8,7 @@
 
 Object::Object(Mesh* mesh, Material* material)
     : mesh(mesh), material(material), position(0.0f), orientation(1.0f, 0.0f, 0.0f, 0.0f), scale(1.0f),
+      previousPosition(0.0f), previousOrientation(1.0f, 0.0f, 0.0f, 0.0f),
       velocity(0.0f), linearMomentum(0.0f), mass(1.0f), collisionRadius(0.0f), fixedObject(false),
       angularVelocity(0.0f), angularMomentum(0.0f), 
       inverseInertiaTensorBody(glm::mat3(1.0f)), inverseInertiaTensorWorld(glm::mat3(1.0f)),
@@ -35,20 +37,55 @@ void Object::setAsSphere(float radius, float density) {
     inverseInertiaTensorBody = glm::inverse(I0);
 }
 
+void Object::setAsConvexHull(float density) {
+    convexHull = mesh->getConvexHull();
+    isConvexHull = true;
+    collisionRadius = 0.0f;
+
+    // Flat or degenerate hull: fall back to the inertia of its (thickened) bounding box
+    if (!convexHull->hasFaces()) {
+        glm::vec3 size = glm::max((convexHull->boundsMax - convexHull->boundsMin) * scale, glm::vec3(0.01f));
+        setAsBox(size.x, size.y, size.z, density);
+        return;
+    }
+
+    // [Covariance] Sum over the tetrahedra joining the model origin to each face. The body rotates
+    // about its position, so the tensor is taken about the origin rather than the centroid.
+    static const glm::mat3 canonical = glm::mat3(2.0f, 1.0f, 1.0f, 1.0f, 2.0f, 1.0f, 1.0f, 1.0f, 2.0f) / 120.0f;
+    float volume = 0.0f;
+    glm::mat3 covariance(0.0f);
+    for (const auto& tri : convexHull->triangles) {
+        glm::mat3 A(convexHull->vertices[tri.x] * scale, convexHull->vertices[tri.y] * scale, convexHull->vertices[tri.z] * scale);
+        float det = glm::determinant(A);
+        volume += det / 6.0f;
+        covariance += det * A * canonical * glm::transpose(A);
+    }
+    mass = volume * density;
+    glm::mat3 I0 = (covariance[0][0] + covariance[1][1] + covariance[2][2]) * glm::mat3(1.0f) - covariance;
+    inverseInertiaTensorBody = glm::inverse(I0 * density);
+}
+
 void Object::draw(Shader& shader) {
+    draw(shader, getModelMatrix());
+}
+
+void Object::draw(Shader& shader, const glm::mat4& model) {
     material->use(shader);
-    glm::mat4 model = getModelMatrix();
     shader.set("model", model);
     mesh->draw();
 }
 
-void Object::setPosition(const glm::vec3& pos) { position = pos; }
-void Object::setRotation(const glm::vec3& euler) { orientation = glm::quat(glm::radians(euler)); }
+void Object::setPosition(const glm::vec3& pos) { position = previousPosition = pos; }
+void Object::setRotation(const glm::vec3& euler) { orientation = previousOrientation = glm::quat(glm::radians(euler)); }
 void Object::setScale(const glm::vec3& scl) { scale = scl; }
 
 glm::mat4 Object::getModelMatrix() const {
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-    model = model * glm::toMat4(orientation);
+    return getModelMatrix(position, orientation);
+}
+
+glm::mat4 Object::getModelMatrix(const glm::vec3& pos, const glm::quat& rot) const {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
+    model = model * glm::toMat4(rot);
     model = glm::scale(model, scale);
     return model;
 }
@@ -109,6 +146,10 @@ void Object::resetForces() {
 }
 
 void Object::toGPU(GPUObject& gpuObject, std::vector<GPUTriangle>& gpuTriangles, size_t triangle_offset) const {
+    toGPU(gpuObject, gpuTriangles, triangle_offset, getModelMatrix());
+}
+
+void Object::toGPU(GPUObject& gpuObject, std::vector<GPUTriangle>& gpuTriangles, size_t triangle_offset, const glm::mat4& model) const {
     glm::vec3 baseColor = this->material->diffuse;
     float reflect = this->material->reflectivity;
     float roughness = this->material->roughness;
@@ -119,8 +160,9 @@ void Object::toGPU(GPUObject& gpuObject, std::vector<GPUTriangle>& gpuTriangles,
 
     if (isSphere) {
         float r = scale.x; // Assume uniform scale
-        glm::vec3 bmin = position - glm::vec3(r);
-        glm::vec3 bmax = position + glm::vec3(r);
+        glm::vec3 center(model[3]);
+        glm::vec3 bmin = center - glm::vec3(r);
+        glm::vec3 bmax = center + glm::vec3(r);
         
         gpuObject.bmin = glm::vec4(bmin, 1.0f); // 1.0f means sphere
         gpuObject.bmax = glm::vec4(bmax, (float)triangle_offset);
@@ -129,11 +171,10 @@ void Object::toGPU(GPUObject& gpuObject, std::vector<GPUTriangle>& gpuTriangles,
 
         // For spheres, we use one dummy triangle to store material/color/center in v0
         GPUTriangle& tri = gpuTriangles[triangle_offset];
-        tri.v0 = glm::vec4(position, 1.0f);
+        tri.v0 = glm::vec4(center, 1.0f);
         tri.color = glm::vec4(baseColor, 1.0f);
         tri.material = matInfo;
     } else {
-        glm::mat4 model = getModelMatrix();
         size_t numTris = mesh->indices.size() / 3;
         glm::vec3 bmin(1e30f), bmax(-1e30f);
 
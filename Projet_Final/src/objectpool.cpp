@@ -0,0 +1,17 @@
+#include "objectpool.h"
+
+ObjectPool::~ObjectPool() {
+    for (Object* obj : freeObjects) delete obj;
+}
+
+Object* ObjectPool::acquire(Mesh* mesh, Material* material) {
+    if (freeObjects.empty()) return new Object(mesh, material);
+    Object* obj = freeObjects.back();
+    freeObjects.pop_back();
+    *obj = Object(mesh, material);
+    return obj;
+}
+
+void ObjectPool::release(Object* obj) {
+    if (obj) freeObjects.push_back(obj);
+}
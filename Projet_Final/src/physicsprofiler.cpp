@@ -0,0 +1,53 @@
+#include "physicsprofiler.h"
+#include <algorithm>
+#include <cstdio>
+
+void PhysicsProfiler::setCapacity(int newCapacity) {
+    capacity = std::max(1, newCapacity);
+    ring.clear();
+    clear();
+}
+
+void PhysicsProfiler::record(const StepStats& stats) {
+    if ((int)ring.size() != capacity) ring.resize(capacity);
+    if (count < capacity) {
+        ring[(head + count) % capacity] = stats;
+        ++count;
+    } else {
+        // Full: overwrite the oldest
+        ring[head] = stats;
+        head = (head + 1) % capacity;
+    }
+}
+
+bool PhysicsProfiler::writeCSV(const std::string& path) const {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "step,integrate_ms,broad_phase_ms,narrow_phase_ms,merge_ms,pre_step_ms,solve_ms,integrate_positions_ms,sleep_ms,total_ms,pairs,contacts,iterations");
+    for (int p = 0; p < (int)ShapePair::Count; ++p) std::fprintf(file, ",%s_tests", shapePairName((ShapePair)p));
+    std::fprintf(file, "\n");
+
+    for (int i = 0; i < count; ++i) {
+        const StepStats& s = (*this)[i];
+        std::fprintf(file, "%lld,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d",
+                     s.step, s.integrate, s.broadPhase, s.narrowPhase, s.merge, s.preStep, s.solve,
+                     s.integratePositions, s.sleep, s.total(), s.pairs, s.contacts, s.iterations);
+        for (int p = 0; p < (int)ShapePair::Count; ++p) std::fprintf(file, ",%d", s.narrowTests[p]);
+        std::fprintf(file, "\n");
+    }
+    return std::fclose(file) == 0;
+}
+
+const char* PhysicsProfiler::shapePairName(ShapePair pair) {
+    switch (pair) {
+        case ShapePair::SphereSphere: return "sphere_sphere";
+        case ShapePair::SphereBox:    return "sphere_box";
+        case ShapePair::BoxBox:       return "box_box";
+        case ShapePair::Convex:       return "convex";
+        case ShapePair::Floor:        return "floor";
+        case ShapePair::StaticMesh:   return "static_mesh";
+        case ShapePair::Heightfield:  return "heightfield";
+        default:                      return "unknown";
+    }
+}
@@ -0,0 +1,105 @@
+#include "physicsthread.h"
+#include "scene.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+typedef std::chrono::steady_clock Clock;
+
+static double clockSeconds(Clock::time_point t) {
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+float PhysicsSnapshot::interpolationFactor() const {
+    double alpha = (accumulator + clockSeconds(Clock::now()) - publishTime) / fixedTimeStep;
+    return (float)std::min(std::max(alpha, 0.0), 1.0);
+}
+
+PhysicsThread::~PhysicsThread() {
+    stop();
+}
+
+void PhysicsThread::start(Scene* newScene) {
+    stop();
+    scene = newScene;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        publish(0.0, 1.0f, 0.0);
+    }
+    running = true;
+    thread = std::thread(&PhysicsThread::run, this);
+}
+
+void PhysicsThread::stop() {
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+void PhysicsThread::run() {
+    const double dt = fixedTimeStep;
+    Clock::time_point previous = Clock::now();
+    double accumulator = 0.0;
+    double timeScale = 1.0;
+
+    while (running) {
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - previous).count();
+        previous = now;
+        accumulator += elapsed;
+
+        int steps = 0;
+        Clock::time_point tickStart = Clock::now();
+        while (accumulator >= dt && steps < maxStepsPerTick && running) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (Object* obj : scene->objects) {
+                obj->previousPosition = obj->position;
+                obj->previousOrientation = obj->orientation;
+            }
+            scene->step(fixedTimeStep);
+            ++stepCount;
+            accumulator -= dt;
+            ++steps;
+        }
+        double stepMs = steps ? std::chrono::duration<double, std::milli>(Clock::now() - tickStart).count() / steps : 0.0;
+
+        // [Time dilation] Out of budget: the backlog is dropped rather than carried into the next
+        // ticks, so simulated time falls behind real time instead of the step count snowballing
+        double dropped = 0.0;
+        if (accumulator >= dt) {
+            dropped = accumulator - std::fmod(accumulator, dt);
+            accumulator -= dropped;
+        }
+        if (elapsed > 0.0) {
+            double tickScale = std::max(0.0, 1.0 - dropped / elapsed);
+            timeScale += (std::min(tickScale, 1.0) - timeScale) * 0.1;
+        }
+
+        if (steps > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            publish(stepMs, (float)timeScale, accumulator);
+        }
+
+        // Sleep until the next step is due
+        double wait = dt - accumulator;
+        if (wait > 0.0) std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    }
+}
+
+void PhysicsThread::publish(double stepMs, float timeScale, double accumulator) {
+    PhysicsSnapshot& snapshot = snapshots.back();
+    snapshot.bodies.resize(scene->objects.size());
+    for (size_t i = 0; i < scene->objects.size(); ++i) {
+        Object* obj = scene->objects[i];
+        snapshot.bodies[i] = {obj, obj->previousPosition, obj->position, obj->previousOrientation, obj->orientation};
+    }
+    snapshot.stepCount = stepCount;
+    snapshot.stepMs = stepMs;
+    snapshot.timeScale = timeScale;
+    snapshot.awake = scene->solver.getAwakeCount();
+    snapshot.asleep = scene->solver.getSleepingCount();
+    snapshot.iterations = scene->solver.getIterationsUsed();
+    snapshot.publishTime = clockSeconds(Clock::now());
+    snapshot.accumulator = accumulator;
+    snapshot.fixedTimeStep = fixedTimeStep;
+    snapshots.publish();
+}
@@ -1,6 +1,7 @@
 #include "renderer.h"
 #include "scene.h"
 #include "object.h"
+#include "physicsthread.h"
 #include <glad/glad.h>
 #include <omp.h>
 #include <vector>
@@ -26,15 +27,15 @@ Renderer::~Renderer() {
     glDeleteBuffers(1, &objectSSBO);
 }
 
-double Renderer::render(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool raytracingMode, bool wireframeMode) {
+double Renderer::render(Scene& scene, const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool raytracingMode, bool wireframeMode) {
     glViewport(0, 0, screenWidth, screenHeight);
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     if (raytracingMode) {
-        return renderRaytraced(scene, view, projection, cameraPos);
+        return renderRaytraced(scene, snapshot, view, projection, cameraPos);
     } else {
-        renderRaster(scene, view, projection, cameraPos, wireframeMode);
+        renderRaster(snapshot, view, projection, cameraPos, wireframeMode);
         return 0.0;
     }
 }
@@ -52,7 +53,7 @@ void Renderer::resize(unsigned int w, unsigned int h) {
     frameCounter = 1; // Reset accumulation
 }
 
-void Renderer::renderRaster(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool wireframeMode) {
+void Renderer::renderRaster(const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos, bool wireframeMode) {
     glEnable(GL_DEPTH_TEST);
     glViewport(0, 0, screenWidth, screenHeight);
     
@@ -61,12 +62,15 @@ void Renderer::renderRaster(Scene& scene, const glm::mat4& view, const glm::mat4
 
     rasterShader.use();
     
+    float alpha = snapshot.interpolationFactor();
+
     // Find the first emissive object to use as the light source for rasterization
     glm::vec3 lPos(30.0f, 50.0f, 20.0f);
     glm::vec3 lCol(1.0f, 0.9f, 0.7f);
-    for (auto* obj : scene.objects) {
+    for (const auto& body : snapshot.bodies) {
+        const Object* obj = body.object;
         if (obj->material && glm::length(obj->material->emissive) > 0.1f) {
-            lPos = obj->position;
+            lPos = body.positionAt(alpha);
             lCol = obj->material->emissive * obj->material->emissiveStrength;
             break;
         }
@@ -78,7 +82,8 @@ void Renderer::renderRaster(Scene& scene, const glm::mat4& view, const glm::mat4
     rasterShader.set("view", view);
     rasterShader.set("projection", projection);
 
-    for (auto* obj : scene.objects) {
+    for (const auto& body : snapshot.bodies) {
+        Object* obj = body.object;
         if (obj->material) {
             rasterShader.set("objectColor", obj->material->diffuse);
         } else {
@@ -90,18 +95,18 @@ void Renderer::renderRaster(Scene& scene, const glm::mat4& view, const glm::mat4
                 rasterShader.set("objectColor", 0.4f, 0.4f, 0.8f);
             }
         }
-        obj->draw(rasterShader);
+        obj->draw(rasterShader, obj->getModelMatrix(body.positionAt(alpha), body.orientationAt(alpha)));
     }
 }
 
-double Renderer::renderRaytraced(Scene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
+double Renderer::renderRaytraced(Scene& scene, const PhysicsSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPos) {
     glDisable(GL_DEPTH_TEST);
     double prepStart = glfwGetTime();
 
     // Determine if scene is static (no non-fixed objects)
     bool isStatic = true;
-    for (auto* obj : scene.objects) {
-        if (!obj->fixedObject) {
+    for (const auto& body : snapshot.bodies) {
+        if (!body.object->fixedObject) {
             isStatic = false;
             break;
         }
@@ -117,21 +122,24 @@ double Renderer::renderRaytraced(Scene& scene, const glm::mat4& view, const glm:
     }
 
     // 1. Prepare data for GPU
-    std::vector<size_t> offsets(scene.objects.size() + 1);
+    const std::vector<BodyTransform>& bodies = snapshot.bodies;
+    float alpha = snapshot.interpolationFactor();
+    std::vector<size_t> offsets(bodies.size() + 1);
     offsets[0] = 0;
-    for(size_t i = 0; i < scene.objects.size(); ++i) {
-        offsets[i+1] = offsets[i] + scene.objects[i]->mesh->indices.size() / 3;
+    for(size_t i = 0; i < bodies.size(); ++i) {
+        offsets[i+1] = offsets[i] + bodies[i].object->mesh->indices.size() / 3;
     }
 
     size_t totalTris = offsets.back();
     if (totalTris == 0) return 0.0;
 
     std::vector<GPUTriangle> gpuTriangles(totalTris);
-    std::vector<GPUObject> gpuObjects(scene.objects.size());
+    std::vector<GPUObject> gpuObjects(bodies.size());
 
     #pragma omp parallel for
-    for (int i = 0; i < (int)scene.objects.size(); ++i) {
-        scene.objects[i]->toGPU(gpuObjects[i], gpuTriangles, offsets[i]);
+    for (int i = 0; i < (int)bodies.size(); ++i) {
+        const Object* obj = bodies[i].object;
+        obj->toGPU(gpuObjects[i], gpuTriangles, offsets[i], obj->getModelMatrix(bodies[i].positionAt(alpha), bodies[i].orientationAt(alpha)));
     }
 
     double prepTime = glfwGetTime() - prepStart;
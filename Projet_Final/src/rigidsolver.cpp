@@ -1,7 +1,13 @@
 #include "rigidsolver.h"
+#include "narrowphase.h"
+#include "convexhull.h"
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/norm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <type_traits>
 #include <omp.h>
 #include <iostream>
 
@@ -9,350 +15,1560 @@ RigidSolver::RigidSolver(glm::vec3 gravity, float floorY)
     : gravity(gravity), floorY(floorY) {}
 
 void RigidSolver::addObject(Object* object) {
-    if (object) objects.push_back(object);
+    if (!object) return;
+    object->bodyIndex = (int)objects.size();
+    objects.push_back(object);
+    AABB box = computeBounds(object);
+
+    // [Static partition] Fixed bodies go into their own tree, which is never refit, and stay out
+    // of the per-step broad phase
+    bool fixed = object->fixedObject;
+    staticBodies.push_back(fixed);
+    if (fixed) {
+        proxies.push_back(staticTree.createProxy(box, object->bodyIndex));
+        sapProxies.push_back(-1);
+        staticCount++;
+    } else {
+        proxies.push_back(tree.createProxy(box, object->bodyIndex));
+        sapProxies.push_back(sap.createProxy(box, object->bodyIndex));
+    }
 }
 
-struct OBB {
-    glm::vec3 center;
-    glm::vec3 axes[3];
-    glm::vec3 halfExtents;
-};
+void RigidSolver::removeObject(Object* object) {
+    if (!object) return;
+    int i = object->bodyIndex;
+    if (i < 0 || i >= (int)objects.size() || objects[i] != object) return;
+
+    if (object->sleeping && i < (int)sleepGroup.size()) {
+        wakeBody(i);
+        wakeFlaggedGroups();
+    }
+
+    if (staticBodies[i]) {
+        staticTree.destroyProxy(proxies[i]);
+        staticCount--;
+    } else {
+        tree.destroyProxy(proxies[i]);
+        sap.destroyProxy(sapProxies[i]);
+    }
+
+    // [Swap-remove] The last body takes the freed slot
+    int last = (int)objects.size() - 1;
+    if (i != last) {
+        objects[i] = objects[last];
+        objects[i]->bodyIndex = i;
+        proxies[i] = proxies[last];
+        sapProxies[i] = sapProxies[last];
+        staticBodies[i] = staticBodies[last];
+        if (staticBodies[i]) {
+            staticTree.setProxyBody(proxies[i], i);
+        } else {
+            tree.setProxyBody(proxies[i], i);
+            sap.setProxyBody(sapProxies[i], i);
+        }
+        if (last < (int)sleepGroup.size()) sleepGroup[i] = sleepGroup[last];
+    }
+    objects.pop_back();
+    proxies.pop_back();
+    sapProxies.pop_back();
+    staticBodies.pop_back();
+    if ((int)sleepGroup.size() > last) sleepGroup.pop_back();
+    object->bodyIndex = -1;
 
-static OBB getOBB(Object* obj) {
-    OBB obb;
-    obb.center = obj->position;
-    glm::mat3 R = glm::toMat3(obj->orientation);
-    obb.axes[0] = R[0]; obb.axes[1] = R[1]; obb.axes[2] = R[2];
-    obb.halfExtents = obj->scale * 0.5f;
-    return obb;
+    // Last step's contacts refer to the old numbering, and the object may come back from a pool
+    constraints.clear();
+    rows.clear();
+    contactCache.erase(std::remove_if(contactCache.begin(), contactCache.end(), [&](const CachedContact& c) {
+        return c.objA == object || c.objB == object;
+    }), contactCache.end());
+}
+
+// Sleeping and fixed bodies are skipped by integration and never start a contact
+static bool isActive(const Object* obj) {
+    return !obj->fixedObject && !obj->sleeping;
+}
+
+// One extra static body at index n stands for the floor
+void BodyStore::resize(int n) {
+    position.resize(n + 1);
+    orientation.resize(n + 1);
+    velocity.resize(n + 1);
+    angularVelocity.resize(n + 1);
+    invMass.resize(n + 1);
+    invInertiaWorld.resize(n + 1);
+    deltaPosition.resize(n + 1);
+    deltaRotation.resize(n + 1);
+
+    position[n] = glm::vec3(0.0f);
+    orientation[n] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    velocity[n] = glm::vec3(0.0f);
+    angularVelocity[n] = glm::vec3(0.0f);
+    invMass[n] = 0.0f;
+    invInertiaWorld[n] = glm::mat3(0.0f);
+    deltaPosition[n] = glm::vec3(0.0f);
+    deltaRotation[n] = glm::vec3(0.0f);
+}
+
+// [Structure of arrays] Copies the simulated state out of the Objects, which may have been
+// edited by the scene since the last step. Inactive bodies get a zero inverse mass.
+void RigidSolver::loadBodies() {
+    bodies.resize((int)objects.size());
+    #pragma omp parallel for
+    for (int i = 0; i < bodies.size(); ++i) loadBody(i);
+}
+
+void RigidSolver::loadBody(int i) {
+    const Object* obj = objects[i];
+    bool active = isActive(obj);
+    bodies.position[i] = obj->position;
+    bodies.orientation[i] = obj->orientation;
+    bodies.velocity[i] = obj->velocity;
+    bodies.angularVelocity[i] = obj->angularVelocity;
+    bodies.invMass[i] = active ? 1.0f / obj->mass : 0.0f;
+    bodies.invInertiaWorld[i] = active ? obj->inverseInertiaTensorWorld : glm::mat3(0.0f);
+    bodies.deltaPosition[i] = glm::vec3(0.0f);
+    bodies.deltaRotation[i] = glm::vec3(0.0f);
+}
+
+// Writes the integrated state back to the Objects, once per step
+void RigidSolver::storeBodies() {
+    #pragma omp parallel for
+    for (int i = 0; i < bodies.size(); ++i) {
+        if (bodies.invMass[i] == 0.0f) continue;
+        Object* obj = objects[i];
+        obj->position = bodies.position[i];
+        obj->orientation = bodies.orientation[i];
+        obj->velocity = bodies.velocity[i];
+        obj->angularVelocity = bodies.angularVelocity[i];
+        obj->inverseInertiaTensorWorld = bodies.invInertiaWorld[i];
+        obj->linearMomentum = bodies.velocity[i] * obj->mass;
+    }
 }
 
 void RigidSolver::step(float deltaTime) {
+    stats = StepStats();
+    stats.step = stepCount++;
+    double phaseStart = omp_get_wtime();
+    auto endPhase = [&](double& phase) {
+        double now = omp_get_wtime();
+        phase += (now - phaseStart) * 1000.0;
+        phaseStart = now;
+    };
+
+    // Bodies added since the last step start awake
+    // Sleep groups are labeled by body index, and labels from before a removal may exceed the count
+    sleepGroup.resize(objects.size(), -1);
+    if (wakeGroups.size() < objects.size()) wakeGroups.resize(objects.size(), 0);
+
+    // 0. Wake sleeping islands whose bodies were given a velocity from outside
+    if (!allowSleeping) {
+        if (sleepingCount > 0) wakeAll();
+    } else if (sleepingCount > 0) {
+        bool flagged = false;
+        for (int i = 0; i < (int)objects.size(); ++i) {
+            Object* obj = objects[i];
+            if (obj->sleeping && (glm::length2(obj->velocity) > 0.0f || glm::length2(obj->angularVelocity) > 0.0f)) {
+                wakeBody(i);
+                flagged = true;
+            }
+        }
+        if (flagged) wakeFlaggedGroups();
+    }
+    endPhase(stats.sleep);
+
+    loadBodies();
+
     // 1. Integrate Forces (Velocity) - Parallelized
+    // Sub-stepping applies gravity itself, once per sub-step
+    bool subStepping = (solverMode == SolverMode::TGS);
     #pragma omp parallel for
-    for (int i = 0; i < (int)objects.size(); ++i) {
-        Object* obj = objects[i];
-        if (obj->fixedObject) continue;
+    for (int i = 0; i < bodies.size(); ++i) {
+        if (bodies.invMass[i] == 0.0f) continue;
         // [Semi-implicit Euler integration]
-        obj->velocity += gravity * deltaTime; 
-        
+        if (!subStepping) bodies.velocity[i] += gravity * deltaTime;
+
         // [Damping]
-        obj->velocity *= 0.999f;
-        obj->angularVelocity *= 0.999f;
+        bodies.velocity[i] *= 0.999f;
+        bodies.angularVelocity[i] *= 0.999f;
     }
 
-    // 2. Collision Detection
-    constraints.clear();
-    detectCollisions();
+    endPhase(stats.integrate);
+
+    // 2. Collision Detection (times its broad and narrow phases itself)
+    detectCollisions(deltaTime);
+
+    // A contact reaching into a sleeping island wakes all of it, whose own contacts then have to be found
+    phaseStart = omp_get_wtime();
+    while (wakeTouchedBodies()) {
+        endPhase(stats.sleep);
+        detectCollisions(deltaTime);
+        phaseStart = omp_get_wtime();
+    }
+    endPhase(stats.sleep);
+
+    // 3. Solve, 4. Integrate Position (the solvers time their pre-step and iterations themselves)
+    if (subStepping) {
+        solveSubSteps(deltaTime);
+        phaseStart = omp_get_wtime();
+    } else {
+        solve(deltaTime);
+        phaseStart = omp_get_wtime();
+        integratePositions(deltaTime);
+        endPhase(stats.integratePositions);
+    }
+    updateInertia();
+
+    storeBodies();
+    endPhase(stats.integrate);
 
-    // 3. Solve (PGS)
-    solve(deltaTime);
+    // 5. Put resting islands to sleep
+    updateSleep();
+    endPhase(stats.sleep);
 
-    // 4. Integrate Position - Parallelized
+    stats.contacts = (int)constraints.size();
+    stats.iterations = iterationsUsed;
+    PHYSICS_PROFILE(profiler.record(stats));
+}
+
+// Moves every active body by its velocity over h, keeping track of the motion since the step started
+void RigidSolver::integratePositions(float h) {
     #pragma omp parallel for
-    for (int i = 0; i < (int)objects.size(); ++i) {
-        Object* obj = objects[i];
-        if (obj->fixedObject) continue;
-        obj->position += obj->velocity * deltaTime;
-        
+    for (int i = 0; i < bodies.size(); ++i) {
+        if (bodies.invMass[i] == 0.0f) continue;
+        bodies.position[i] += bodies.velocity[i] * h;
+        bodies.deltaPosition[i] += bodies.velocity[i] * h;
+
         // Correct angular integration
-        float angVelLen = glm::length(obj->angularVelocity);
+        float angVelLen = glm::length(bodies.angularVelocity[i]);
         if (angVelLen > 0.0001f) {
-            glm::vec3 axis = obj->angularVelocity / angVelLen;
-            float angle = angVelLen * deltaTime;
+            glm::vec3 axis = bodies.angularVelocity[i] / angVelLen;
+            float angle = angVelLen * h;
             glm::quat deltaRot = glm::angleAxis(angle, axis);
-            obj->orientation = glm::normalize(deltaRot * obj->orientation);
+            bodies.orientation[i] = glm::normalize(deltaRot * bodies.orientation[i]);
+            bodies.deltaRotation[i] += bodies.angularVelocity[i] * h;
         }
-        
-        // Update Inertia Tensor and Momentum
-        glm::mat3 rotationMat = glm::toMat3(obj->orientation);
-        obj->inverseInertiaTensorWorld = rotationMat * obj->inverseInertiaTensorBody * glm::transpose(rotationMat);
-        obj->linearMomentum = obj->velocity * obj->mass;
     }
 }
 
-void RigidSolver::solve(float dt) {
-    const int iterations = 20;
+// World inverse inertia from the final orientation, once per step
+void RigidSolver::updateInertia() {
+    #pragma omp parallel for
+    for (int i = 0; i < bodies.size(); ++i) {
+        if (bodies.invMass[i] == 0.0f) continue;
+        glm::mat3 rotationMat = glm::toMat3(bodies.orientation[i]);
+        bodies.invInertiaWorld[i] = rotationMat * objects[i]->inverseInertiaTensorBody * glm::transpose(rotationMat);
+    }
+}
+
+// Pre-step: builds the solver row of one contact (effective masses, friction basis, angular
+// Jacobians already multiplied by the inverse inertia, velocity bias)
+static void prepareContact(const BodyStore& bodies, const ContactConstraint& c, ContactRow& row, float dt) {
     const float beta = 0.10f;
-    const float slop = 0.01f;  
-
-    // Pre-Step
-    for (auto& c : constraints) {
-        float invMA = c.objA->fixedObject ? 0.0f : 1.0f / c.objA->mass;
-        float invMB = (c.objB == nullptr || c.objB->fixedObject) ? 0.0f : 1.0f / c.objB->mass;
-        glm::mat3 invIA = c.objA->inverseInertiaTensorWorld;
-        glm::mat3 invIB = (c.objB == nullptr || c.objB->fixedObject) ? glm::mat3(0.0f) : c.objB->inverseInertiaTensorWorld;
-
-        c.rA = c.contactPoint - c.objA->position;
-        c.rB = (c.objB) ? (c.contactPoint - c.objB->position) : glm::vec3(0.0f);
-
-        // K = JM^-1J^T (Normal)
-        glm::vec3 raCn = glm::cross(c.rA, c.normal);
-        glm::vec3 rbCn = glm::cross(c.rB, c.normal);
-        float K = invMA + invMB + glm::dot(raCn, invIA * raCn) + glm::dot(rbCn, invIB * rbCn);
-        c.massNormal = (K > 0.0f) ? 1.0f / K : 0.0f;
-
-        // Find tangents
-        if (std::abs(c.normal.x) >= 0.577f) c.tangent1 = glm::normalize(glm::vec3(c.normal.y, -c.normal.x, 0.0f));
-        else c.tangent1 = glm::normalize(glm::vec3(0.0f, c.normal.z, -c.normal.y));
-        c.tangent2 = glm::cross(c.normal, c.tangent1);
-        
-        auto calcKt = [&](const glm::vec3& t) {
-            glm::vec3 raCt = glm::cross(c.rA, t);
-            glm::vec3 rbCt = glm::cross(c.rB, t);
-            float Kt = invMA + invMB + glm::dot(raCt, invIA * raCt) + glm::dot(rbCt, invIB * rbCt);
-            return (Kt > 0.0f) ? 1.0f / Kt : 0.0f;
-        };
-        c.massTangent1 = calcKt(c.tangent1);
-        c.massTangent2 = calcKt(c.tangent2);
-
-        // Find initial relative velocity
-        glm::vec3 vA = c.objA->velocity + glm::cross(c.objA->angularVelocity, c.rA);
-        glm::vec3 vB = (c.objB) ? (c.objB->velocity + glm::cross(c.objB->angularVelocity, c.rB)) : glm::vec3(0.0f);
-        float vRel = glm::dot(c.normal, vA - vB);
-
-        // Bias
-        float restitution = (c.objB) ? std::min(c.objA->restitution, c.objB->restitution) : c.objA->restitution;
+    const float slop = 0.01f;
+
+    int a = c.bodyA;
+    int b = (c.bodyB >= 0) ? c.bodyB : bodies.world();
+    row.bodyA = a;
+    row.bodyB = b;
+    row.invMassA = bodies.invMass[a];
+    row.invMassB = bodies.invMass[b];
+    const glm::mat3& invIA = bodies.invInertiaWorld[a];
+    const glm::mat3& invIB = bodies.invInertiaWorld[b];
+
+    glm::vec3 rA = c.contactPoint - bodies.position[a];
+    glm::vec3 rB = (c.bodyB >= 0) ? (c.contactPoint - bodies.position[b]) : glm::vec3(0.0f);
+
+    // Find tangents
+    row.normal = c.normal;
+    if (std::abs(c.normal.x) >= 0.577f) row.tangent1 = glm::normalize(glm::vec3(c.normal.y, -c.normal.x, 0.0f));
+    else row.tangent1 = glm::normalize(glm::vec3(0.0f, c.normal.z, -c.normal.y));
+    row.tangent2 = glm::cross(c.normal, row.tangent1);
+
+    // K = JM^-1J^T for the normal and the two tangents
+    const glm::vec3 dirs[3] = {row.normal, row.tangent1, row.tangent2};
+    for (int d = 0; d < 3; ++d) {
+        row.crossA[d] = glm::cross(rA, dirs[d]);
+        row.crossB[d] = glm::cross(rB, dirs[d]);
+        row.angularA[d] = invIA * row.crossA[d];
+        row.angularB[d] = invIB * row.crossB[d];
+        float K = row.invMassA + row.invMassB + glm::dot(row.crossA[d], row.angularA[d]) + glm::dot(row.crossB[d], row.angularB[d]);
+        row.mass[d] = (K > 0.0f) ? 1.0f / K : 0.0f;
+        row.impulse[d] = 0.0f;
+    }
+
+    // Find initial relative velocity
+    glm::vec3 vA = bodies.velocity[a] + glm::cross(bodies.angularVelocity[a], rA);
+    glm::vec3 vB = bodies.velocity[b] + glm::cross(bodies.angularVelocity[b], rB);
+    float vRel = glm::dot(c.normal, vA - vB);
+
+    // Material, read once here so the iterations never touch the Object
+    float restitution = (c.objB) ? std::min(c.objA->restitution, c.objB->restitution) : c.objA->restitution;
+    row.friction = (c.objB) ? (c.objA->friction + c.objB->friction) * 0.5f : c.objA->friction;
+    row.penetration = c.penetration;
+    row.normalVelocity = vRel;
+    row.restitution = restitution;
+    row.maxImpulse = 0.0f;
+
+    if (c.penetration < 0.0f) {
+        // [Speculative contacts] Still apart: the gap may close during this step, but no more
+        row.bias = c.penetration / dt;
+
+        // Impact within this step: bounce now, the approach speed would be gone on arrival
+        if (restitution > 0.0f && vRel < -1.0f && vRel * dt < c.penetration) {
+            row.bias = std::max(row.bias, -restitution * vRel);
+        }
+    } else {
         // [Baumgarte stabilization]
-        c.bias = (beta / dt) * std::max(0.0f, c.penetration - slop);
-        
+        row.bias = (beta / dt) * std::max(0.0f, c.penetration - slop);
+
         // Add restitution bias if objects are hitting hard
-        if (vRel < -1.0f) c.bias += -restitution * vRel;
-        
-        c.impulseSum = 0.0f;
-        c.impulseTangent1 = 0.0f;
-        c.impulseTangent2 = 0.0f;
-    }
-
-    // [Projected Gauss-Seidel]
-    for (int i = 0; i < iterations; ++i) {
-        for (auto& c : constraints) {
-            float invMA = c.objA->fixedObject ? 0.0f : 1.0f / c.objA->mass;
-            float invMB = (c.objB == nullptr || c.objB->fixedObject) ? 0.0f : 1.0f / c.objB->mass;
-            glm::mat3 invIA = c.objA->inverseInertiaTensorWorld;
-            glm::mat3 invIB = (c.objB == nullptr || c.objB->fixedObject) ? glm::mat3(0.0f) : c.objB->inverseInertiaTensorWorld;
-
-            // Normal
-            glm::vec3 vA = c.objA->velocity + glm::cross(c.objA->angularVelocity, c.rA);
-            glm::vec3 vB = (c.objB) ? (c.objB->velocity + glm::cross(c.objB->angularVelocity, c.rB)) : glm::vec3(0.0f);
-            float vRel = glm::dot(c.normal, vA - vB);
-            
-            float lambda = c.massNormal * (c.bias - vRel);
-            float oldImpulse = c.impulseSum;
-            c.impulseSum = std::max(0.0f, oldImpulse + lambda);
-            lambda = c.impulseSum - oldImpulse;
-            
-            glm::vec3 P = lambda * c.normal;
-            c.objA->velocity += invMA * P;
-            c.objA->angularVelocity += invIA * glm::cross(c.rA, P);
-            if (c.objB && !c.objB->fixedObject) {
-                c.objB->velocity -= invMB * P;
-                c.objB->angularVelocity -= invIB * glm::cross(c.rB, P);
+        if (vRel < -1.0f) row.bias += -restitution * vRel;
+    }
+}
+
+// Velocity of A relative to B along direction d of the row
+static float rowVelocity(const ContactRow& row, int d, const glm::vec3& dir,
+                         const glm::vec3& vA, const glm::vec3& wA, const glm::vec3& vB, const glm::vec3& wB) {
+    return glm::dot(dir, vA - vB) + glm::dot(row.crossA[d], wA) - glm::dot(row.crossB[d], wB);
+}
+
+// [Projected Gauss-Seidel] One visit of a row: normal impulse, then the two friction directions.
+// Only dot products and velocity updates are left; both bodies are loaded once into locals.
+// Fixed bodies (and the world body behind floor contacts) are never written, so rows that only
+// share a fixed body can be solved concurrently.
+// Returns the largest relative velocity change the visit applied, the residual used for early termination.
+static float solveContact(BodyStore& bodies, ContactRow& row) {
+    int a = row.bodyA, b = row.bodyB;
+    glm::vec3 vA = bodies.velocity[a], wA = bodies.angularVelocity[a];
+    glm::vec3 vB = bodies.velocity[b], wB = bodies.angularVelocity[b];
+    const glm::vec3 dirs[3] = {row.normal, row.tangent1, row.tangent2};
+
+    auto apply = [&](int d, float lambda) {
+        vA += (row.invMassA * lambda) * dirs[d];
+        wA += lambda * row.angularA[d];
+        vB -= (row.invMassB * lambda) * dirs[d];
+        wB -= lambda * row.angularB[d];
+    };
+
+    // Normal
+    float lambda = row.mass[0] * (row.bias - rowVelocity(row, 0, dirs[0], vA, wA, vB, wB));
+    float oldImpulse = row.impulse[0];
+    row.impulse[0] = std::max(0.0f, oldImpulse + lambda);
+    apply(0, row.impulse[0] - oldImpulse);
+    float residual = std::abs(row.impulse[0] - oldImpulse) / row.mass[0];
+
+    // Friction, inside the [Coulomb cone]
+    float maxF = row.friction * row.impulse[0];
+    for (int d = 1; d < 3; ++d) {
+        float lambdaT = -row.mass[d] * rowVelocity(row, d, dirs[d], vA, wA, vB, wB);
+        float oldT = row.impulse[d];
+        row.impulse[d] = std::max(-maxF, std::min(maxF, oldT + lambdaT));
+        apply(d, row.impulse[d] - oldT);
+        residual = std::max(residual, std::abs(row.impulse[d] - oldT) / row.mass[d]);
+    }
+
+    if (row.invMassA > 0.0f) {
+        bodies.velocity[a] = vA;
+        bodies.angularVelocity[a] = wA;
+    }
+    if (row.invMassB > 0.0f) {
+        bodies.velocity[b] = vB;
+        bodies.angularVelocity[b] = wB;
+    }
+    return residual;
+}
+
+// [Union-find] Groups dynamic bodies linked by contacts. Fixed bodies and the floor never merge islands.
+void RigidSolver::buildIslands() {
+    int n = (int)objects.size();
+    islandParent.resize(n);
+    for (int i = 0; i < n; ++i) islandParent[i] = i;
+
+    auto find = [&](int i) {
+        while (islandParent[i] != i) {
+            islandParent[i] = islandParent[islandParent[i]];
+            i = islandParent[i];
+        }
+        return i;
+    };
+
+    for (const auto& c : constraints) {
+        if (c.objA->fixedObject || c.objB == nullptr || c.objB->fixedObject) continue;
+        int rootA = find(c.bodyA), rootB = find(c.bodyB);
+        if (rootA != rootB) islandParent[std::max(rootA, rootB)] = std::min(rootA, rootB);
+    }
+
+    // Roots are always the smallest index, so one forward pass flattens every path
+    for (int i = 0; i < n; ++i) islandParent[i] = islandParent[islandParent[i]];
+
+    // Number islands in order of first appearance and bucket their constraints.
+    // The counting sort is stable, so each island keeps the serial constraint order.
+    bodyIsland.assign(n, -1);
+    constraintIsland.resize(constraints.size());
+    int islandCount = 0;
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        const auto& c = constraints[k];
+        int root = find(c.objA->fixedObject ? c.bodyB : c.bodyA);
+        if (bodyIsland[root] == -1) bodyIsland[root] = islandCount++;
+        constraintIsland[k] = bodyIsland[root];
+    }
+
+    islandStarts.assign(islandCount + 1, 0);
+    for (int island : constraintIsland) islandStarts[island + 1]++;
+    for (int i = 0; i < islandCount; ++i) islandStarts[i + 1] += islandStarts[i];
+
+    islandConstraints.resize(constraints.size());
+    islandFill.assign(islandStarts.begin(), islandStarts.end() - 1);
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        islandConstraints[islandFill[constraintIsland[k]]++] = k;
+    }
+}
+
+// Colors available to the greedy coloring, one bit each in a body's mask
+static const int maxColors = 64;
+
+// [Graph coloring] Greedy coloring of the constraint graph: two constraints of the same color never
+// touch the same dynamic body. Fixed bodies and the floor are never written, so they add no conflicts.
+// Constraints that find no free color among the 64 available go to a last batch solved serially.
+void RigidSolver::buildColors() {
+    bodyColors.assign(objects.size(), 0);
+    constraintColor.resize(constraints.size());
+
+    int colorCount = 0;
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        const auto& c = constraints[k];
+        bool dynA = !c.objA->fixedObject;
+        bool dynB = c.objB && !c.objB->fixedObject;
+        uint64_t used = (dynA ? bodyColors[c.bodyA] : 0) | (dynB ? bodyColors[c.bodyB] : 0);
+
+        int color = maxColors;
+        if (used != ~0ull) {
+            color = 0;
+            while (used & (1ull << color)) ++color;
+            if (dynA) bodyColors[c.bodyA] |= 1ull << color;
+            if (dynB) bodyColors[c.bodyB] |= 1ull << color;
+        }
+        constraintColor[k] = color;
+        colorCount = std::max(colorCount, color + 1);
+    }
+
+    colorStarts.assign(colorCount + 1, 0);
+    for (int color : constraintColor) colorStarts[color + 1]++;
+    for (int i = 0; i < colorCount; ++i) colorStarts[i + 1] += colorStarts[i];
+
+    colorConstraints.resize(constraints.size());
+    colorFill.assign(colorStarts.begin(), colorStarts.end() - 1);
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        colorConstraints[colorFill[constraintColor[k]]++] = k;
+    }
+}
+
+// [Warm starting] Applies the impulses carried over from the previous step
+static void warmStartContact(BodyStore& bodies, const ContactRow& row) {
+    int a = row.bodyA, b = row.bodyB;
+    glm::vec3 P = row.impulse[0] * row.normal + row.impulse[1] * row.tangent1 + row.impulse[2] * row.tangent2;
+    glm::vec3 angular = row.impulse[0] * row.angularA[0] + row.impulse[1] * row.angularA[1] + row.impulse[2] * row.angularA[2];
+    if (row.invMassA > 0.0f) {
+        bodies.velocity[a] += row.invMassA * P;
+        bodies.angularVelocity[a] += angular;
+    }
+    if (row.invMassB > 0.0f) {
+        angular = row.impulse[0] * row.angularB[0] + row.impulse[1] * row.angularB[1] + row.impulse[2] * row.angularB[2];
+        bodies.velocity[b] -= row.invMassB * P;
+        bodies.angularVelocity[b] -= angular;
+    }
+}
+
+static bool pairLess(const CachedContact& e, const Object* a, const Object* b) {
+    return (uintptr_t)e.objA < (uintptr_t)a || (e.objA == a && (uintptr_t)e.objB < (uintptr_t)b);
+}
+
+// Cache order: by body pair, then static surface and feature
+static bool cacheLess(const CachedContact& x, const CachedContact& y) {
+    if (x.objA != y.objA || x.objB != y.objB) return pairLess(x, y.objA, y.objB);
+    if (x.collider != y.collider) return x.collider < y.collider;
+    return x.feature < y.feature;
+}
+
+// Finds last step's contact for the same body pair, by feature first and then by proximity in A's frame
+void RigidSolver::recallImpulses(const ContactConstraint& c, ContactRow& row) const {
+    const float matchDistance = 0.05f;
+
+    auto first = std::lower_bound(contactCache.begin(), contactCache.end(), c, [](const CachedContact& e, const ContactConstraint& k) {
+        return pairLess(e, k.objA, k.objB);
+    });
+
+    glm::vec3 localPoint = glm::conjugate(bodies.orientation[c.bodyA]) * (c.contactPoint - bodies.position[c.bodyA]);
+    const CachedContact* match = nullptr;
+    float bestDistSq = matchDistance * matchDistance;
+    for (auto it = first; it != contactCache.end() && it->objA == c.objA && it->objB == c.objB; ++it) {
+        // The floor and the static colliders all pair with no body, and their feature ids overlap
+        if (it->collider != c.collider) continue;
+        if (c.feature >= 0 && it->feature == c.feature) { match = &*it; break; }
+        float distSq = glm::distance2(it->localPointA, localPoint);
+        if (distSq < bestDistSq) { bestDistSq = distSq; match = &*it; }
+    }
+    if (!match) return;
+
+    // The friction basis is rebuilt every step, so project the old friction impulse on it
+    row.impulse[0] = match->impulseNormal;
+    row.impulse[1] = glm::dot(match->frictionImpulse, row.tangent1);
+    row.impulse[2] = glm::dot(match->frictionImpulse, row.tangent2);
+}
+
+// Rebuilds the contact cache from this step's accumulated impulses, sorted by body pair
+void RigidSolver::storeImpulses() {
+    contactCache.resize(constraints.size());
+
+    #pragma omp parallel for
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        const auto& c = constraints[k];
+        const auto& row = rows[k];
+        CachedContact& e = contactCache[k];
+        e.objA = c.objA;
+        e.objB = c.objB;
+        e.collider = c.collider;
+        e.feature = c.feature;
+        e.localPointA = glm::conjugate(bodies.orientation[c.bodyA]) * (c.contactPoint - bodies.position[c.bodyA]);
+        e.impulseNormal = row.impulse[0];
+        e.frictionImpulse = row.impulse[1] * row.tangent1 + row.impulse[2] * row.tangent2;
+    }
+
+    // Stable: contacts sharing a pair and a feature keep the constraint order, not one that depends on
+    // how the unstable sort met the object addresses, so replays recall the same impulses
+    std::stable_sort(contactCache.begin(), contactCache.end(), cacheLess);
+}
+
+void RigidSolver::solve(float dt) {
+    double start = omp_get_wtime();
+
+    // Pre-Step (each contact only reads body state)
+    rows.resize(constraints.size());
+    #pragma omp parallel for
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        prepareContact(bodies, constraints[k], rows[k], dt);
+        if (warmStarting) recallImpulses(constraints[k], rows[k]);
+    }
+
+    // A single tall stack is one island; colors expose the parallelism inside it
+    if (parallelSolve == ParallelSolve::GraphColoring) buildColors();
+    else if (parallelSolve == ParallelSolve::Islands) buildIslands();
+
+    double preStepEnd = omp_get_wtime();
+    stats.preStep += (preStepEnd - start) * 1000.0;
+
+    // [Early termination] Iterations stop once a full sweep changes no relative velocity by more
+    // than the tolerance; 'iterations' only caps the hard steps
+    iterationsUsed = 0;
+
+    if (parallelSolve == ParallelSolve::Serial) {
+        if (warmStarting) {
+            for (auto& row : rows) warmStartContact(bodies, row);
+        }
+        for (int i = 0; i < iterations; ++i) {
+            float residual = 0.0f;
+            for (auto& row : rows) residual = std::max(residual, solveContact(bodies, row));
+            iterationsUsed = i + 1;
+            if (residual < solverTolerance) break;
+        }
+    } else if (parallelSolve == ParallelSolve::GraphColoring) {
+        int colorCount = (int)colorStarts.size() - 1;
+
+        // Residuals of the current and the next iteration: the next one is cleared while
+        // every thread still reads the current one
+        float residual[2] = {0.0f, 0.0f};
+        int used = 0;
+
+        // Warm starting writes bodies too, so it goes through the color batches as well
+        #pragma omp parallel
+        for (int i = (warmStarting ? -1 : 0); i < iterations; ++i) {
+            float local = 0.0f;
+            for (int color = 0; color < colorCount; ++color) {
+                if (color == maxColors) {
+                    // Overflow batch may share bodies
+                    #pragma omp single
+                    for (int k = colorStarts[color]; k < colorStarts[color + 1]; ++k) {
+                        if (i < 0) warmStartContact(bodies, rows[colorConstraints[k]]);
+                        else local = std::max(local, solveContact(bodies, rows[colorConstraints[k]]));
+                    }
+                } else {
+                    #pragma omp for schedule(static)
+                    for (int k = colorStarts[color]; k < colorStarts[color + 1]; ++k) {
+                        if (i < 0) warmStartContact(bodies, rows[colorConstraints[k]]);
+                        else local = std::max(local, solveContact(bodies, rows[colorConstraints[k]]));
+                    }
+                }
+            }
+            if (i < 0) continue;
+
+            #pragma omp critical
+            residual[i & 1] = std::max(residual[i & 1], local);
+
+            // Implicit barrier: all residuals are in before anyone tests them
+            #pragma omp single
+            {
+                residual[(i + 1) & 1] = 0.0f;
+                used = i + 1;
             }
+            if (residual[i & 1] < solverTolerance) break;
+        }
+        iterationsUsed = used;
+    } else {
+        // [Simulation islands] Islands share no dynamic body, so each one runs its own
+        // PGS iterations on a separate thread, and stops as soon as it has converged.
+        // A single island reproduces the serial order exactly.
+        int islandCount = (int)islandStarts.size() - 1;
+        int used = 0;
 
-            // Friction
-            float mu = (c.objB) ? (c.objA->friction + c.objB->friction) * 0.5f : c.objA->friction;
-            auto solveT = [&](glm::vec3& t, float& massT, float& impulseT) {
-                glm::vec3 vA_t = c.objA->velocity + glm::cross(c.objA->angularVelocity, c.rA);
-                glm::vec3 vB_t = (c.objB) ? (c.objB->velocity + glm::cross(c.objB->angularVelocity, c.rB)) : glm::vec3(0.0f);
-                float vt = glm::dot(t, vA_t - vB_t);
-                float lambdaT = -massT * vt;
-                
-                // [Coulomb cone]
-                float maxF = mu * c.impulseSum;
-                float oldT = impulseT;
-                impulseT = std::max(-maxF, std::min(maxF, oldT + lambdaT));
-                lambdaT = impulseT - oldT;
-                
-                glm::vec3 PT = lambdaT * t;
-                c.objA->velocity += invMA * PT;
-                c.objA->angularVelocity += invIA * glm::cross(c.rA, PT);
-                if (c.objB && !c.objB->fixedObject) {
-                    c.objB->velocity -= invMB * PT;
-                    c.objB->angularVelocity -= invIB * glm::cross(c.rB, PT);
+        #pragma omp parallel for schedule(dynamic) reduction(max:used)
+        for (int island = 0; island < islandCount; ++island) {
+            if (warmStarting) {
+                for (int k = islandStarts[island]; k < islandStarts[island + 1]; ++k) {
+                    warmStartContact(bodies, rows[islandConstraints[k]]);
                 }
-            };
-            solveT(c.tangent1, c.massTangent1, c.impulseTangent1);
-            solveT(c.tangent2, c.massTangent2, c.impulseTangent2);
+            }
+            for (int i = 0; i < iterations; ++i) {
+                float residual = 0.0f;
+                for (int k = islandStarts[island]; k < islandStarts[island + 1]; ++k) {
+                    residual = std::max(residual, solveContact(bodies, rows[islandConstraints[k]]));
+                }
+                used = std::max(used, i + 1);
+                if (residual < solverTolerance) break;
+            }
+        }
+        iterationsUsed = used;
+    }
+
+    storeImpulses();
+    stats.solve += (omp_get_wtime() - preStepEnd) * 1000.0;
+}
+
+// [Soft constraints] Spring-damper coefficients of a contact for a sub-step h: stiffness 'hertz',
+// damping ratio 'zeta'. The mass and impulse scales soften the correction instead of a Baumgarte factor.
+struct Softness {
+    float biasRate, massScale, impulseScale;
+};
+
+static Softness makeSoftness(float hertz, float zeta, float h) {
+    float omega = 2.0f * glm::pi<float>() * hertz;
+    float a1 = 2.0f * zeta + h * omega;
+    float a2 = h * omega * a1;
+    float a3 = 1.0f / (1.0f + a2);
+    return {omega / a1, a2 * a3, a3};
+}
+
+// [Temporal Gauss-Seidel] One visit of a row during a sub-step. The separation is re-estimated from
+// how far both bodies moved since detection, so the bias tracks the contact without a new narrow phase.
+// Without useBias (the relax pass) penetration is no longer pushed out, which removes the energy
+// the soft correction added.
+static void solveContactSoft(BodyStore& bodies, ContactRow& row, const Softness& soft, float invH, bool useBias) {
+    const float maxPushVelocity = 3.0f;
+
+    int a = row.bodyA, b = row.bodyB;
+    glm::vec3 vA = bodies.velocity[a], wA = bodies.angularVelocity[a];
+    glm::vec3 vB = bodies.velocity[b], wB = bodies.angularVelocity[b];
+    const glm::vec3 dirs[3] = {row.normal, row.tangent1, row.tangent2};
+
+    auto apply = [&](int d, float lambda) {
+        vA += (row.invMassA * lambda) * dirs[d];
+        wA += lambda * row.angularA[d];
+        vB -= (row.invMassB * lambda) * dirs[d];
+        wB -= lambda * row.angularB[d];
+    };
+
+    // Linearized: the contact point of each body moves by dp + dtheta x r
+    float separation = -row.penetration
+        + glm::dot(row.normal, bodies.deltaPosition[a] - bodies.deltaPosition[b])
+        + glm::dot(row.crossA[0], bodies.deltaRotation[a]) - glm::dot(row.crossB[0], bodies.deltaRotation[b]);
+
+    float bias = 0.0f, massScale = 1.0f, impulseScale = 0.0f;
+    if (separation > 0.0f) {
+        // [Speculative contacts] Close the gap within this sub-step, but no more
+        bias = separation * invH;
+    } else if (useBias) {
+        bias = std::max(soft.biasRate * separation, -maxPushVelocity);
+        massScale = soft.massScale;
+        impulseScale = soft.impulseScale;
+    }
+
+    // Normal
+    float lambda = -row.mass[0] * massScale * (rowVelocity(row, 0, dirs[0], vA, wA, vB, wB) + bias) - impulseScale * row.impulse[0];
+    float oldImpulse = row.impulse[0];
+    row.impulse[0] = std::max(0.0f, oldImpulse + lambda);
+    row.maxImpulse = std::max(row.maxImpulse, row.impulse[0]);
+    apply(0, row.impulse[0] - oldImpulse);
+
+    // Friction, inside the [Coulomb cone]
+    float maxF = row.friction * row.impulse[0];
+    for (int d = 1; d < 3; ++d) {
+        float lambdaT = -row.mass[d] * rowVelocity(row, d, dirs[d], vA, wA, vB, wB);
+        float oldT = row.impulse[d];
+        row.impulse[d] = std::max(-maxF, std::min(maxF, oldT + lambdaT));
+        apply(d, row.impulse[d] - oldT);
+    }
+
+    if (row.invMassA > 0.0f) {
+        bodies.velocity[a] = vA;
+        bodies.angularVelocity[a] = wA;
+    }
+    if (row.invMassB > 0.0f) {
+        bodies.velocity[b] = vB;
+        bodies.angularVelocity[b] = wB;
+    }
+}
+
+// Restitution once the sub-steps are done, for contacts that actually touched while approaching fast:
+// the normal velocity is driven to -e times the approach velocity seen at detection
+static void applyRestitution(BodyStore& bodies, ContactRow& row) {
+    if (row.restitution == 0.0f || row.normalVelocity > -1.0f || row.maxImpulse == 0.0f) return;
+
+    int a = row.bodyA, b = row.bodyB;
+    float vn = rowVelocity(row, 0, row.normal, bodies.velocity[a], bodies.angularVelocity[a],
+                           bodies.velocity[b], bodies.angularVelocity[b]);
+    float lambda = -row.mass[0] * (vn + row.restitution * row.normalVelocity);
+    float oldImpulse = row.impulse[0];
+    row.impulse[0] = std::max(0.0f, oldImpulse + lambda);
+    lambda = row.impulse[0] - oldImpulse;
+
+    if (row.invMassA > 0.0f) {
+        bodies.velocity[a] += (row.invMassA * lambda) * row.normal;
+        bodies.angularVelocity[a] += lambda * row.angularA[0];
+    }
+    if (row.invMassB > 0.0f) {
+        bodies.velocity[b] -= (row.invMassB * lambda) * row.normal;
+        bodies.angularVelocity[b] -= lambda * row.angularB[0];
+    }
+}
+
+// One pass of a row kernel over all rows, with the parallelism of the selected mode.
+// Islands and colors must have been built for this step's constraints.
+template <typename Kernel>
+void RigidSolver::sweepRows(const Kernel& kernel) {
+    if (parallelSolve == ParallelSolve::Serial) {
+        for (auto& row : rows) kernel(row);
+    } else if (parallelSolve == ParallelSolve::GraphColoring) {
+        int colorCount = (int)colorStarts.size() - 1;
+        #pragma omp parallel
+        for (int color = 0; color < colorCount; ++color) {
+            if (color == maxColors) {
+                #pragma omp single
+                for (int k = colorStarts[color]; k < colorStarts[color + 1]; ++k) kernel(rows[colorConstraints[k]]);
+            } else {
+                #pragma omp for schedule(static)
+                for (int k = colorStarts[color]; k < colorStarts[color + 1]; ++k) kernel(rows[colorConstraints[k]]);
+            }
+        }
+    } else {
+        int islandCount = (int)islandStarts.size() - 1;
+        #pragma omp parallel for schedule(dynamic)
+        for (int island = 0; island < islandCount; ++island) {
+            for (int k = islandStarts[island]; k < islandStarts[island + 1]; ++k) kernel(rows[islandConstraints[k]]);
+        }
+    }
+}
+
+// [Temporal Gauss-Seidel] Detection already ran once for the whole step. Each sub-step integrates
+// gravity, warm starts, runs one soft velocity sweep, moves the bodies, then relaxes once without bias.
+// Small sub-steps converge stacks better than many iterations on one large step, at a lower cost.
+void RigidSolver::solveSubSteps(float dt) {
+    int count = std::max(1, subSteps);
+    float h = dt / count;
+    float invH = 1.0f / h;
+
+    // Stiffness is limited by the sub-step rate
+    Softness soft = makeSoftness(std::min(30.0f, 0.25f * invH), 10.0f, h);
+
+    double start = omp_get_wtime();
+    rows.resize(constraints.size());
+    #pragma omp parallel for
+    for (int k = 0; k < (int)constraints.size(); ++k) {
+        prepareContact(bodies, constraints[k], rows[k], dt);
+        if (warmStarting) recallImpulses(constraints[k], rows[k]);
+    }
+
+    if (parallelSolve == ParallelSolve::GraphColoring) buildColors();
+    else if (parallelSolve == ParallelSolve::Islands) buildIslands();
+    iterationsUsed = count;
+
+    double preStepEnd = omp_get_wtime();
+    stats.preStep += (preStepEnd - start) * 1000.0;
+
+    for (int s = 0; s < count; ++s) {
+        #pragma omp parallel for
+        for (int i = 0; i < bodies.size(); ++i) {
+            if (bodies.invMass[i] != 0.0f) bodies.velocity[i] += gravity * h;
+        }
+
+        // Impulses accumulate per sub-step, so the previous sub-step's total is applied again
+        if (warmStarting || s > 0) sweepRows([&](ContactRow& row) { warmStartContact(bodies, row); });
+        sweepRows([&](ContactRow& row) { solveContactSoft(bodies, row, soft, invH, true); });
+        integratePositions(h);
+        sweepRows([&](ContactRow& row) { solveContactSoft(bodies, row, soft, invH, false); });
+    }
+
+    sweepRows([&](ContactRow& row) { applyRestitution(bodies, row); });
+
+    storeImpulses();
+    stats.solve += (omp_get_wtime() - preStepEnd) * 1000.0;
+}
+
+double RigidSolver::measureSolveCost(int repeats) {
+    if (rows.empty() || repeats <= 0) return 0.0;
+
+    std::vector<glm::vec3> velocity = bodies.velocity, angularVelocity = bodies.angularVelocity;
+    std::vector<ContactRow> saved = rows;
+    double total = 0.0;
+    for (int r = 0; r < repeats; ++r) {
+        double start = omp_get_wtime();
+        for (int i = 0; i < iterations; ++i) {
+            for (auto& row : rows) solveContact(bodies, row);
         }
+        total += omp_get_wtime() - start;
+
+        bodies.velocity = velocity;
+        bodies.angularVelocity = angularVelocity;
+        rows = saved;
+    }
+    return total * 1e9 / ((double)repeats * iterations * rows.size());
+}
+
+AABB RigidSolver::computeBounds(const Object* obj) const {
+    const float margin = 0.05f;
+    glm::vec3 extent;
+    if (obj->collisionRadius > 0.0f) {
+        extent = glm::vec3(obj->collisionRadius);
+    } else if (obj->isConvexHull) {
+        // Scaled hull bounds, which need not be centered on the body's position
+        glm::mat3 R = glm::toMat3(obj->orientation);
+        glm::vec3 center = obj->position + R * ((obj->convexHull->boundsMin + obj->convexHull->boundsMax) * 0.5f * obj->scale);
+        glm::vec3 h = glm::abs((obj->convexHull->boundsMax - obj->convexHull->boundsMin) * 0.5f * obj->scale);
+        extent = glm::abs(R[0]) * h.x + glm::abs(R[1]) * h.y + glm::abs(R[2]) * h.z;
+        return {center - extent - margin, center + extent + margin};
+    } else {
+        // Project the OBB half extents onto the world axes
+        glm::mat3 R = glm::toMat3(obj->orientation);
+        glm::vec3 h = obj->scale * 0.5f;
+        extent = glm::abs(R[0]) * h.x + glm::abs(R[1]) * h.y + glm::abs(R[2]) * h.z;
+    }
+    return {obj->position - extent - margin, obj->position + extent + margin};
+}
+
+void RigidSolver::updateBounds(float dt) {
+    bounds.resize(objects.size());
+    #pragma omp parallel for
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        // Static bodies are found through the static tree only
+        if (staticBodies[i]) {
+            bounds[i] = {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+            continue;
+        }
+        bounds[i] = computeBounds(objects[i]);
+
+        // [Speculative contacts] Boxes cover the whole motion of the step, so fast bodies meet
+        // what lies in their path before they reach it
+        glm::vec3 motion = bodies.velocity[i] * dt;
+        bounds[i].min += glm::min(motion, glm::vec3(0.0f));
+        bounds[i].max += glm::max(motion, glm::vec3(0.0f));
+    }
+}
+
+// Bounding radius of a body around its center
+static float boundingRadius(const Object* obj) {
+    if (obj->collisionRadius > 0.0f) return obj->collisionRadius;
+    if (obj->isConvexHull) return getConvexShape(obj).boundingRadius();
+    return glm::length(obj->scale * 0.5f);
+}
+
+// [Speculative contacts] Upper bound of how much the gap between two bodies (or a body and the
+// floor, b = -1, or static meshes, b = -2) can close during the step. Contacts are created up to
+// this distance apart.
+float RigidSolver::closingDistance(int a, int b, float dt) const {
+    float rotation = glm::length(bodies.angularVelocity[a]) * boundingRadius(objects[a]);
+    if (b == -1) return (std::max(0.0f, -bodies.velocity[a].y) + rotation) * dt;
+    if (b < 0) return (glm::length(bodies.velocity[a]) + rotation) * dt;
+    rotation += glm::length(bodies.angularVelocity[b]) * boundingRadius(objects[b]);
+    return (glm::length(bodies.velocity[a] - bodies.velocity[b]) + rotation) * dt;
+}
+
+#ifdef PHYSICS_PROFILING
+// Tallies a pair that goes on to collidePair's shape tests
+static void countPairTest(const Object* A, const Object* B, int* narrowTests) {
+    if (!isActive(A) && !isActive(B)) return;
+    ShapePair pair;
+    if (A->isConvexHull || B->isConvexHull) pair = ShapePair::Convex;
+    else if (A->collisionRadius > 0.0f && B->collisionRadius > 0.0f) pair = ShapePair::SphereSphere;
+    else if (A->collisionRadius > 0.0f || B->collisionRadius > 0.0f) pair = ShapePair::SphereBox;
+    else pair = ShapePair::BoxBox;
+    ++narrowTests[(int)pair];
+}
+#endif
+
+// Records the solver indices of the bodies behind the contacts appended since 'first'
+static void setBodies(std::vector<ContactConstraint>& list, size_t first, int bodyA, int bodyB) {
+    for (size_t k = first; k < list.size(); ++k) {
+        list[k].bodyA = bodyA;
+        list[k].bodyB = bodyB;
+    }
+}
+
+// [Static partition] Awake dynamic bodies query the static tree; static-static pairs never come up.
+// The new pairs are merged into the sorted list, keeping the order of the brute-force loop.
+void RigidSolver::findStaticPairs() {
+    size_t dynamicPairs = pairs.size();
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        if (!isActive(objects[i])) continue;
+        staticTree.query(bounds[i], [&](int body) {
+            pairs.push_back({std::min(i, body), std::max(i, body)});
+        });
     }
+    std::sort(pairs.begin() + dynamicPairs, pairs.end());
+    std::inplace_merge(pairs.begin(), pairs.begin() + dynamicPairs, pairs.end());
 }
 
-void RigidSolver::detectCollisions() {
+void RigidSolver::detectCollisions(float dt) {
+    double start = omp_get_wtime();
+    if (broadPhase == BroadPhaseMode::SpatialHash) {
+        updateBounds(dt);
+        grid.cellSize = cellSize;
+        grid.build(bounds);
+        grid.findPairs(bounds, pairs);
+    } else if (broadPhase == BroadPhaseMode::AABBTree) {
+        updateBounds(dt);
+        // Only leaves that left their fat box are reinserted
+        for (int i = 0; i < (int)objects.size(); ++i) {
+            if (!staticBodies[i]) tree.moveProxy(proxies[i], bounds[i]);
+        }
+        tree.findPairs(pairs);
+    } else if (broadPhase == BroadPhaseMode::SweepAndPrune) {
+        updateBounds(dt);
+        for (int i = 0; i < (int)objects.size(); ++i) {
+            if (!staticBodies[i]) sap.moveProxy(sapProxies[i], bounds[i]);
+        }
+        sap.update();
+        sap.getPairs(pairs);
+        sap.clearPairEvents();
+    }
+    if (broadPhase != BroadPhaseMode::BruteForce && staticCount > 0) findStaticPairs();
+    double broadPhaseEnd = omp_get_wtime();
+    stats.broadPhase += (broadPhaseEnd - start) * 1000.0;
+    stats.pairs += (broadPhase == BroadPhaseMode::BruteForce) ? (int)(objects.size() * (objects.size() - 1) / 2) : (int)pairs.size();
+
+    // [Contact arenas] Each thread appends to its own buffers, which keep their capacity between steps
+    int maxThreads = omp_get_max_threads();
+    if ((int)contactArenas.size() < maxThreads) contactArenas.resize(maxThreads);
+    arenaOffsets.resize(2 * maxThreads + 1);
+    double mergeStart = 0.0;
+
     #pragma omp parallel
     {
-        std::vector<ContactConstraint> localConstraints;
+        int thread = omp_get_thread_num();
+        int threadCount = omp_get_num_threads();
+        std::vector<ContactConstraint>& floorContacts = contactArenas[thread].floorContacts;
+        std::vector<ContactConstraint>& pairContacts = contactArenas[thread].pairContacts;
+        floorContacts.clear();
+        pairContacts.clear();
+        PHYSICS_PROFILE(int* narrowTests = contactArenas[thread].narrowTests);
+        PHYSICS_PROFILE(std::fill(narrowTests, narrowTests + (int)ShapePair::Count, 0));
 
-        // Fast Sphere-Ground check
-        #pragma omp for nowait
+        // Fast Sphere-Ground check (static schedules give each thread a contiguous range, in thread order)
+        #pragma omp for schedule(static) nowait
         for (int i = 0; i < (int)objects.size(); ++i) {
             Object* obj = objects[i];
-            if (obj->fixedObject) continue;
-            
-            if (obj->collisionRadius > 0.0f) {
-                float r = obj->collisionRadius;
-                if (obj->position.y - r < floorY) {
-                    localConstraints.push_back({obj, nullptr, obj->position + glm::vec3(0,-r,0), glm::vec3(0,1,0), floorY - (obj->position.y - r)});
-                }
-            } else {
-                glm::mat3 R = glm::toMat3(obj->orientation);
-                for (const auto& v : obj->mesh->vertices) {
-                    glm::vec3 p = obj->position + R * (v.position * obj->scale);
-                    if (p.y < floorY) localConstraints.push_back({obj, nullptr, p, glm::vec3(0,1,0), floorY - p.y});
-                }
-            }
+            if (!isActive(obj)) continue;
+            size_t first = floorContacts.size();
+            collideFloor(obj, closingDistance(i, -1, dt), floorContacts);
+            if (!staticMeshes.empty()) collideStaticMeshes(obj, closingDistance(i, -2, dt), floorContacts);
+            if (!heightfields.empty()) collideHeightfields(obj, closingDistance(i, -2, dt), floorContacts);
+            setBodies(floorContacts, first, i, -1);
+            PHYSICS_PROFILE({
+                ++narrowTests[(int)ShapePair::Floor];
+                if (!staticMeshes.empty()) ++narrowTests[(int)ShapePair::StaticMesh];
+                if (!heightfields.empty()) ++narrowTests[(int)ShapePair::Heightfield];
+            })
         }
 
-        #pragma omp for
-        for (int i = 0; i < (int)objects.size(); ++i) {
-            for (int j = i + 1; j < (int)objects.size(); ++j) {
-                Object *A = objects[i], *B = objects[j];
-                if (A->fixedObject && B->fixedObject) continue;
-
-                // Broad phase: Simple distance or AABB check
-                float maxRadA = (A->collisionRadius > 0.0f) ? A->collisionRadius : glm::length(A->scale * 0.5f);
-                float maxRadB = (B->collisionRadius > 0.0f) ? B->collisionRadius : glm::length(B->scale * 0.5f);
-                float distSq = glm::distance2(A->position, B->position);
-                float combinedGap = maxRadA + maxRadB + 0.1f;
-                if (distSq > combinedGap * combinedGap) continue;
-
-                if (A->collisionRadius > 0.0f && B->collisionRadius > 0.0f) {
-                    // Optimized Sphere-Sphere
-                    float rA = A->collisionRadius;
-                    float rB = B->collisionRadius;
-                    float d = glm::sqrt(distSq);
-                    if (d < rA + rB) {
-                        glm::vec3 normal = glm::normalize(B->position - A->position);
-                        float penetration = (rA + rB) - d;
-                        localConstraints.push_back({A, B, A->position + normal * rA, -normal, penetration});
-                    }
-                    continue;
-                }
+        if (broadPhase != BroadPhaseMode::BruteForce) {
+            // [SIMD] Box-box pairs are culled 8 at a time by the batched SAT before building contacts
+            int batchCount = ((int)pairs.size() + 7) / 8;
+            #pragma omp for schedule(static)
+            for (int batch = 0; batch < batchCount; ++batch) {
+                int first = batch * 8;
+                int last = std::min(first + 8, (int)pairs.size());
 
-                // Optimized Sphere-Box
-                if ((A->collisionRadius > 0.0f) != (B->collisionRadius > 0.0f)) {
-                    Object* sphere = (A->collisionRadius > 0.0f) ? A : B;
-                    Object* box = (A->collisionRadius > 0.0f) ? B : A;
-                    
-                    glm::mat3 R_inv = glm::transpose(glm::toMat3(box->orientation));
-                    glm::vec3 relCenter = R_inv * (sphere->position - box->position);
-                    glm::vec3 h = box->scale * 0.5f;
-
-                    // Closest point on AABB
-                    glm::vec3 closest;
-                    closest.x = std::max(-h.x, std::min(h.x, relCenter.x));
-                    closest.y = std::max(-h.y, std::min(h.y, relCenter.y));
-                    closest.z = std::max(-h.z, std::min(h.z, relCenter.z));
-
-                    float distSq = glm::distance2(relCenter, closest);
-                    if (distSq < sphere->collisionRadius * sphere->collisionRadius) {
-                        float d = std::sqrt(distSq);
-                        glm::vec3 normal;
-                        float penetration;
-                        
-                        if (d > 0.0001f) {
-                            normal = glm::toMat3(box->orientation) * ((relCenter - closest) / d);
-                            penetration = sphere->collisionRadius - d;
-                        } else {
-                            // Sphere center is inside the box
-                            // Find the minimal penetration axis
-                            glm::vec3 dists = h - glm::abs(relCenter);
-                            if (dists.x < dists.y && dists.x < dists.z) {
-                                normal = box->orientation * glm::vec3(relCenter.x > 0 ? 1 : -1, 0, 0);
-                                penetration = sphere->collisionRadius + dists.x;
-                            } else if (dists.y < dists.z) {
-                                normal = box->orientation * glm::vec3(0, relCenter.y > 0 ? 1 : -1, 0);
-                                penetration = sphere->collisionRadius + dists.y;
-                            } else {
-                                normal = box->orientation * glm::vec3(0, 0, relCenter.z > 0 ? 1 : -1);
-                                penetration = sphere->collisionRadius + dists.z;
-                            }
-                        }
-                        
-                        // Ensure normal points from B to A (the direction the impulse will push A)
-                        // 'normal' is currently Box-to-Sphere (from surface to center)
-                        glm::vec3 contactPoint = box->position + glm::toMat3(box->orientation) * closest;
-                        if (A == sphere) {
-                            localConstraints.push_back({A, B, contactPoint, normal, penetration});
-                        } else {
-                            localConstraints.push_back({A, B, contactPoint, -normal, penetration});
-                        }
-                    }
-                    continue;
+                OBBBatch boxesA{}, boxesB{};
+                int boxLanes = 0;
+                for (int k = first; k < last; ++k) {
+                    Object* A = objects[pairs[k].a];
+                    Object* B = objects[pairs[k].b];
+                    if (A->collisionRadius > 0.0f || B->collisionRadius > 0.0f) continue;
+                    if (A->isConvexHull || B->isConvexHull) continue;
+                    if (!isActive(A) && !isActive(B)) continue;
+                    boxesA.set(k - first, getOBB(A));
+                    boxesB.set(k - first, getOBB(B));
+                    boxLanes |= 1 << (k - first);
                 }
+                int overlapping = boxLanes ? overlapOBB8(boxesA, boxesB) : 0;
 
-                // [Separating Axis Theorem]
-                OBB obbA = getOBB(A), obbB = getOBB(B);
-                float minP = 1e10f; glm::vec3 axis;
-                auto check = [&](glm::vec3 a) {
-                    if (glm::length(a) < 0.001f) return true;
-                    a = glm::normalize(a);
-                    float ra = obbA.halfExtents.x * std::abs(glm::dot(a, obbA.axes[0])) + obbA.halfExtents.y * std::abs(glm::dot(a, obbA.axes[1])) + obbA.halfExtents.z * std::abs(glm::dot(a, obbA.axes[2]));
-                    float rb = obbB.halfExtents.x * std::abs(glm::dot(a, obbB.axes[0])) + obbB.halfExtents.y * std::abs(glm::dot(a, obbB.axes[1])) + obbB.halfExtents.z * std::abs(glm::dot(a, obbB.axes[2]));
-                    float d = glm::dot(obbB.center - obbA.center, a);
-                    float o = ra + rb - std::abs(d);
-                    if (o < 0) return false;
-                    if (o < minP) { minP = o; axis = (d > 0) ? -a : a; }
-                    return true;
-                };
-                bool hit = check(obbA.axes[0]) && check(obbA.axes[1]) && check(obbA.axes[2]) && check(obbB.axes[0]) && check(obbB.axes[1]) && check(obbB.axes[2]);
-                if (hit) { for(int x=0; x<3; ++x) for(int y=0; y<3; ++y) if(!check(glm::cross(obbA.axes[x], obbB.axes[y]))) { hit = false; break; } }
-                if (hit) {
-                    auto sampleLocal = [&](Object* s, Object* t, glm::vec3 n, bool isS_A, std::vector<ContactConstraint>& constraints_list) {
-                        glm::mat3 Rs = glm::toMat3(s->orientation);
-                        glm::mat3 Rt_inv = glm::transpose(glm::toMat3(t->orientation));
-                        glm::vec3 h_t = t->scale * 0.5f;
-
-                        for(const auto& v : s->mesh->vertices) {
-                            glm::vec3 p = s->position + Rs * (v.position * s->scale);
-                            glm::vec3 pL = Rt_inv * (p - t->position);
-                            if (std::abs(pL.x) <= h_t.x + 0.005f && std::abs(pL.y) <= h_t.y + 0.005f && std::abs(pL.z) <= h_t.z + 0.005f) 
-                            {
-                                float pen; glm::vec3 dummyN;
-                                if (isPointInsideObject(p, t, dummyN, pen)) {
-                                    constraints_list.push_back({A, B, p, axis, pen});
-                                }
-                            }
-                        }
-                    };
-                    
-                    size_t prevCount = localConstraints.size();
-                    sampleLocal(A, B, axis, true, localConstraints);
-                    sampleLocal(B, A, axis, false, localConstraints);
-
-                    if (localConstraints.size() == prevCount) {
-                        localConstraints.push_back({A, B, (obbA.center + obbB.center)*0.5f, axis, minP});
-                    }
+                for (int k = first; k < last; ++k) {
+                    int lane = 1 << (k - first);
+                    if ((boxLanes & lane) && !(overlapping & lane)) continue;
+                    size_t firstContact = pairContacts.size();
+                    float margin = closingDistance(pairs[k].a, pairs[k].b, dt);
+                    PHYSICS_PROFILE(countPairTest(objects[pairs[k].a], objects[pairs[k].b], narrowTests));
+                    collidePair(objects[pairs[k].a], objects[pairs[k].b], margin, pairContacts);
+                    setBodies(pairContacts, firstContact, pairs[k].a, pairs[k].b);
+                }
+            }
+        } else {
+            #pragma omp for schedule(static)
+            for (int i = 0; i < (int)objects.size(); ++i) {
+                for (int j = i + 1; j < (int)objects.size(); ++j) {
+                    size_t first = pairContacts.size();
+                    PHYSICS_PROFILE(countPairTest(objects[i], objects[j], narrowTests));
+                    collidePair(objects[i], objects[j], closingDistance(i, j, dt), pairContacts);
+                    setBodies(pairContacts, first, i, j);
                 }
             }
         }
 
-        #pragma omp critical
+        // [Prefix sum] Floor contacts of every thread, then pair contacts of every thread, in thread order:
+        // the merged list is the serial order whatever the thread count or timing
+        #pragma omp single
         {
-            constraints.insert(constraints.end(), localConstraints.begin(), localConstraints.end());
+            mergeStart = omp_get_wtime();
+            PHYSICS_PROFILE(for (int t = 0; t < threadCount; ++t) {
+                for (int p = 0; p < (int)ShapePair::Count; ++p) stats.narrowTests[p] += contactArenas[t].narrowTests[p];
+            })
+            arenaOffsets[0] = 0;
+            for (int t = 0; t < threadCount; ++t) {
+                arenaOffsets[t + 1] = arenaOffsets[t] + contactArenas[t].floorContacts.size();
+            }
+            for (int t = 0; t < threadCount; ++t) {
+                arenaOffsets[threadCount + t + 1] = arenaOffsets[threadCount + t] + contactArenas[t].pairContacts.size();
+            }
+            constraints.resize(arenaOffsets[2 * threadCount]);
         }
+
+        std::copy(floorContacts.begin(), floorContacts.end(), constraints.begin() + arenaOffsets[thread]);
+        std::copy(pairContacts.begin(), pairContacts.end(), constraints.begin() + arenaOffsets[threadCount + thread]);
     }
+    stats.narrowPhase += (mergeStart - broadPhaseEnd) * 1000.0;
+    stats.merge += (omp_get_wtime() - mergeStart) * 1000.0;
 }
 
-bool RigidSolver::isPointInsideObject(const glm::vec3& p, Object* obj, glm::vec3& normal, float& penetration) {
+// Contacts with a negative penetration are speculative: the gap may close within 'margin' this step
+void RigidSolver::collideFloor(Object* obj, float margin, std::vector<ContactConstraint>& out) {
     if (obj->collisionRadius > 0.0f) {
-        float d = glm::distance(p, obj->position); float r = obj->collisionRadius;
-        if (d < r) { normal = glm::normalize(p - obj->position); penetration = r - d; return true; }
-        return false;
+        float r = obj->collisionRadius;
+        if (obj->position.y - r < floorY + margin) {
+            out.push_back({obj, nullptr, obj->position + glm::vec3(0,-r,0), glm::vec3(0,1,0), floorY - (obj->position.y - r), 0});
+        }
+    } else if (obj->isConvexHull) {
+        // Hull vertices below the floor
+        ContactPoint points[maxManifoldPoints];
+        int count = collideConvexPlane(getConvexShape(obj), glm::vec3(0,1,0), floorY + margin, points);
+        for (int k = 0; k < count; ++k) {
+            out.push_back({obj, nullptr, points[k].position, glm::vec3(0,1,0), points[k].penetration - margin, points[k].feature});
+        }
     } else {
-        glm::mat3 R_inv = glm::transpose(glm::toMat3(obj->orientation));
-        glm::vec3 pL = R_inv * (p - obj->position);
-        glm::vec3 h = obj->scale * 0.5f;
-        if (std::abs(pL.x) <= h.x && std::abs(pL.y) <= h.y && std::abs(pL.z) <= h.z) {
-            float dx = h.x - std::abs(pL.x); float dy = h.y - std::abs(pL.y); float dz = h.z - std::abs(pL.z);
-            if (dx < dy && dx < dz) { normal = glm::toMat3(obj->orientation) * glm::vec3(pL.x > 0 ? 1 : -1, 0, 0); penetration = dx; }
-            else if (dy < dz) { normal = glm::toMat3(obj->orientation) * glm::vec3(0, pL.y > 0 ? 1 : -1, 0); penetration = dy; }
-            else { normal = glm::toMat3(obj->orientation) * glm::vec3(0, 0, pL.z > 0 ? 1 : -1); penetration = dz; }
-            return true;
+        // Box corners below the floor, whatever the tessellation of the mesh
+        ContactPoint points[maxManifoldPoints];
+        int count = collideBoxPlane(getOBB(obj), glm::vec3(0,1,0), floorY + margin, points);
+        for (int k = 0; k < count; ++k) {
+            out.push_back({obj, nullptr, points[k].position, glm::vec3(0,1,0), points[k].penetration - margin, points[k].feature});
+        }
+    }
+}
+
+// Whether a point of the triangle's plane lies only on edges flagged flat (a vertex needs both of its edges)
+static bool onFlatEdges(const TriangleMeshCollider::Triangle& tri, const glm::vec3& p) {
+    const float eps = 1e-3f;
+    glm::vec3 n = glm::cross(tri.v[1] - tri.v[0], tri.v[2] - tri.v[0]);
+    float area = glm::dot(n, n);
+    bool onEdge = false;
+    for (int k = 0; k < 3; ++k) {
+        // Barycentric weight of the corner opposite edge k (v[k] -> v[k+1])
+        const glm::vec3& a = tri.v[k];
+        const glm::vec3& b = tri.v[(k + 1) % 3];
+        float weight = glm::dot(glm::cross(b - a, p - a), n) / area;
+        if (weight > eps) continue;
+        if (!(tri.flatEdges & (1 << k))) return false;
+        onEdge = true;
+    }
+    return onEdge;
+}
+
+void RigidSolver::addStaticMesh(const Mesh& mesh, const glm::mat4& model) {
+    staticMeshes.emplace_back(mesh, model);
+}
+
+// Contacts of one body against a static mesh, merged by normal across its triangles
+const int meshGroupPoints = 16;
+struct MeshContactGroup {
+    int mesh;
+    glm::vec3 normal;
+    int count;
+    ContactPoint points[meshGroupPoints];
+};
+
+// [BVH] Triangles near the body go through the convex narrow phase as flat convex shapes.
+// Contacts only push out of the front side, and those landing on an edge between flat
+// neighbors use the face normal, so bodies slide across the mesh without catching on it.
+// A body resting across several coplanar triangles of a mesh gets one reduced manifold, as on the floor.
+void RigidSolver::collideStaticMeshes(Object* obj, float margin, std::vector<ContactConstraint>& out) const {
+    AABB box = computeBounds(obj);
+    box.min -= glm::vec3(margin);
+    box.max += glm::vec3(margin);
+    ConvexShape shape = getConvexShape(obj);
+
+    const int maxGroups = 8;
+    MeshContactGroup groups[maxGroups];
+    int groupCount = 0;
+    auto emit = [&](int m, const glm::vec3& normal, const ContactPoint& p) {
+        out.push_back({obj, nullptr, p.position, normal, p.penetration, p.feature, 1 + m});
+    };
+
+    for (int m = 0; m < (int)staticMeshes.size(); ++m) {
+        const TriangleMeshCollider& mesh = staticMeshes[m];
+        if (!mesh.getBounds().overlaps(box)) continue;
+        mesh.query(box, [&](int t) {
+            const TriangleMeshCollider::Triangle& tri = mesh.getTriangle(t);
+            ContactPoint points[maxManifoldPoints];
+            glm::vec3 normal;
+            int count = collideConvex(shape, getTriangleShape(tri.v), margin, normal, points);
+            if (count == 0 || glm::dot(normal, tri.normal) <= 0.0f) return;
+
+            bool smooth = glm::dot(normal, tri.normal) < 0.999f;
+            for (int k = 0; k < count && smooth; ++k) smooth = onFlatEdges(tri, points[k].position);
+            if (smooth) {
+                // Depth below the face plane of the body's lowest point along the face normal. A lone
+                // witness point sits on the edge, off to the side of a rolling sphere: use that lowest
+                // point instead so the push does not spin the body.
+                glm::vec3 lowest = shape.support(-tri.normal) - tri.normal * shape.radius;
+                float depth = glm::dot(tri.normal, tri.v[0] - lowest);
+                normal = tri.normal;
+                if (count == 1) points[0].position = lowest;
+                for (int k = 0; k < count; ++k) points[k].penetration = depth;
+            }
+
+            int g = 0;
+            while (g < groupCount && (groups[g].mesh != m || glm::dot(groups[g].normal, normal) < 0.999f)) ++g;
+            if (g == maxGroups) {
+                for (int k = 0; k < count; ++k) emit(m, normal, points[k]);
+                return;
+            }
+            if (g == groupCount) groups[groupCount++] = {m, normal, 0, {}};
+            MeshContactGroup& group = groups[g];
+            if (group.count + count > meshGroupPoints) {
+                ContactPoint reduced[maxManifoldPoints];
+                group.count = reduceManifold(group.points, group.count, group.normal, reduced);
+                std::copy(reduced, reduced + group.count, group.points);
+            }
+            for (int k = 0; k < count; ++k) group.points[group.count++] = points[k];
+        });
+    }
+
+    for (int g = 0; g < groupCount; ++g) {
+        ContactPoint reduced[maxManifoldPoints];
+        int count = reduceManifold(groups[g].points, groups[g].count, groups[g].normal, reduced);
+        for (int k = 0; k < count; ++k) emit(groups[g].mesh, groups[g].normal, reduced[k]);
+    }
+}
+
+void RigidSolver::addHeightfield(const HeightfieldCollider& field) {
+    heightfields.push_back(field);
+}
+
+// [Heightfield] Each core vertex of the body (the center of a sphere) looks up the triangle below it
+// and is tested against that triangle's plane, so the cost does not depend on the grid resolution.
+// Heights are read as they are now: nothing is cached between steps.
+void RigidSolver::collideHeightfields(Object* obj, float margin, std::vector<ContactConstraint>& out) const {
+    ConvexShape shape = getConvexShape(obj);
+    const int maxCandidates = 16;
+    ContactPoint points[maxCandidates];
+    glm::vec3 normals[maxCandidates];
+
+    for (int f = 0; f < (int)heightfields.size(); ++f) {
+        const HeightfieldCollider& field = heightfields[f];
+        int collider = 1 + (int)staticMeshes.size() + f;
+        int count = 0;
+        glm::vec3 averageNormal(0.0f);
+        for (int i = 0; i < shape.vertexCount(); ++i) {
+            glm::vec3 p = shape.vertex(i);
+            float h;
+            glm::vec3 n;
+            if (!field.sample(p.x, p.z, h, n)) continue;
+            float separation = (p.y - h) * n.y - shape.radius;
+            if (separation >= margin) continue;
+
+            // Keep the deepest vertices when there are too many
+            int slot = count;
+            if (count == maxCandidates) {
+                slot = 0;
+                for (int k = 1; k < count; ++k) {
+                    if (points[k].penetration < points[slot].penetration) slot = k;
+                }
+                if (-separation <= points[slot].penetration) continue;
+            } else {
+                ++count;
+            }
+            points[slot] = {p - n * shape.radius, -separation, i};
+            normals[slot] = n;
+        }
+        if (count == 0) continue;
+
+        for (int k = 0; k < count; ++k) averageNormal += normals[k];
+        ContactPoint reduced[maxManifoldPoints];
+        int reducedCount = reduceManifold(points, count, glm::normalize(averageNormal), reduced);
+        for (int k = 0; k < reducedCount; ++k) {
+            int slot = 0;
+            while (points[slot].feature != reduced[k].feature) ++slot;
+            out.push_back({obj, nullptr, reduced[k].position, normals[slot], reduced[k].penetration, reduced[k].feature, collider});
         }
     }
-    return false;
+}
+
+// Pairs with a sphere also get speculative contacts up to 'margin' apart; box-box pairs only touch
+void RigidSolver::collidePair(Object* A, Object* B, float margin, std::vector<ContactConstraint>& out) {
+    // Resting pairs inside a sleeping island are not re-detected
+    if (!isActive(A) && !isActive(B)) return;
+
+    // Broad phase: Simple distance or AABB check
+    float distSq = glm::distance2(A->position, B->position);
+    float combinedGap = boundingRadius(A) + boundingRadius(B) + 0.1f + margin;
+    if (distSq > combinedGap * combinedGap) return;
+
+    // [GJK/EPA] Anything involving a hull goes through the support mappings
+    if (A->isConvexHull || B->isConvexHull) {
+        ContactPoint points[maxManifoldPoints];
+        glm::vec3 normal;
+        int count = collideConvex(getConvexShape(A), getConvexShape(B), margin, normal, points);
+        for (int k = 0; k < count; ++k) {
+            out.push_back({A, B, points[k].position, normal, points[k].penetration, points[k].feature});
+        }
+        return;
+    }
+
+    if (A->collisionRadius > 0.0f && B->collisionRadius > 0.0f) {
+        // Optimized Sphere-Sphere
+        float rA = A->collisionRadius;
+        float rB = B->collisionRadius;
+        float d = glm::sqrt(distSq);
+        if (d < rA + rB + margin) {
+            glm::vec3 normal = glm::normalize(B->position - A->position);
+            float penetration = (rA + rB) - d;
+            out.push_back({A, B, A->position + normal * rA, -normal, penetration, 0});
+        }
+        return;
+    }
+
+    // Optimized Sphere-Box
+    if ((A->collisionRadius > 0.0f) != (B->collisionRadius > 0.0f)) {
+        Object* sphere = (A->collisionRadius > 0.0f) ? A : B;
+        Object* box = (A->collisionRadius > 0.0f) ? B : A;
+        
+        glm::mat3 R_inv = glm::transpose(glm::toMat3(box->orientation));
+        glm::vec3 relCenter = R_inv * (sphere->position - box->position);
+        glm::vec3 h = box->scale * 0.5f;
+
+        // Closest point on AABB
+        glm::vec3 closest;
+        closest.x = std::max(-h.x, std::min(h.x, relCenter.x));
+        closest.y = std::max(-h.y, std::min(h.y, relCenter.y));
+        closest.z = std::max(-h.z, std::min(h.z, relCenter.z));
+
+        float distSq = glm::distance2(relCenter, closest);
+        float reach = sphere->collisionRadius + margin;
+        if (distSq < reach * reach) {
+            float d = std::sqrt(distSq);
+            glm::vec3 normal;
+            float penetration;
+            
+            if (d > 0.0001f) {
+                normal = glm::toMat3(box->orientation) * ((relCenter - closest) / d);
+                penetration = sphere->collisionRadius - d;
+            } else {
+                // Sphere center is inside the box
+                // Find the minimal penetration axis
+                glm::vec3 dists = h - glm::abs(relCenter);
+                if (dists.x < dists.y && dists.x < dists.z) {
+                    normal = box->orientation * glm::vec3(relCenter.x > 0 ? 1 : -1, 0, 0);
+                    penetration = sphere->collisionRadius + dists.x;
+                } else if (dists.y < dists.z) {
+                    normal = box->orientation * glm::vec3(0, relCenter.y > 0 ? 1 : -1, 0);
+                    penetration = sphere->collisionRadius + dists.y;
+                } else {
+                    normal = box->orientation * glm::vec3(0, 0, relCenter.z > 0 ? 1 : -1);
+                    penetration = sphere->collisionRadius + dists.z;
+                }
+            }
+            
+            // Ensure normal points from B to A (the direction the impulse will push A)
+            // 'normal' is currently Box-to-Sphere (from surface to center)
+            glm::vec3 contactPoint = box->position + glm::toMat3(box->orientation) * closest;
+            if (A == sphere) {
+                out.push_back({A, B, contactPoint, normal, penetration, 0});
+            } else {
+                out.push_back({A, B, contactPoint, -normal, penetration, 0});
+            }
+        }
+        return;
+    }
+
+    // [Separating Axis Theorem] Clipped box-box manifold, at most 4 points
+    OBB obbA = getOBB(A), obbB = getOBB(B);
+    ContactPoint points[maxManifoldPoints];
+    glm::vec3 normal;
+    float depth;
+    int count = collideBoxBox(obbA, obbB, normal, depth, points);
+    for (int k = 0; k < count; ++k) {
+        out.push_back({A, B, points[k].position, normal, points[k].penetration, points[k].feature});
+    }
 }
 
 void RigidSolver::reset() {}
 
+// [Sleeping] A body is only flagged here; its whole island wakes in wakeFlaggedGroups()
+void RigidSolver::wakeBody(int body) {
+    if (sleepGroup[body] >= 0) wakeGroups[sleepGroup[body]] = 1;
+}
+
+void RigidSolver::wakeFlaggedGroups() {
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        int group = sleepGroup[i];
+        if (group < 0 || !wakeGroups[group]) continue;
+        objects[i]->sleeping = false;
+        objects[i]->sleepCounter = 0;
+        sleepGroup[i] = -1;
+        // Woken in the middle of a step: the body must be simulated from now on
+        if (i < bodies.size()) loadBody(i);
+        sleepingCount--;
+        awakeCount++;
+    }
+    std::fill(wakeGroups.begin(), wakeGroups.end(), 0);
+}
+
+void RigidSolver::wakeAll() {
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        objects[i]->sleeping = false;
+        objects[i]->sleepCounter = 0;
+    }
+    std::fill(sleepGroup.begin(), sleepGroup.end(), -1);
+    awakeCount += sleepingCount;
+    sleepingCount = 0;
+}
+
+// Every contact has an active body, so any sleeping body it touches must wake up
+bool RigidSolver::wakeTouchedBodies() {
+    if (sleepingCount == 0) return false;
+    bool flagged = false;
+    for (const auto& c : constraints) {
+        if (c.objA->sleeping) { wakeBody(c.bodyA); flagged = true; }
+        if (c.objB && c.objB->sleeping) { wakeBody(c.bodyB); flagged = true; }
+    }
+    if (flagged) wakeFlaggedGroups();
+    return flagged;
+}
+
+// [Sleeping] An island falls asleep once all its bodies stayed slow for sleepSteps steps
+void RigidSolver::updateSleep() {
+    int n = (int)objects.size();
+    if (allowSleeping) {
+        // Islands are only built by the solver in island mode
+        if (parallelSolve != ParallelSolve::Islands) buildIslands();
+
+        groupSleepCounter.assign(n, sleepSteps);
+        const float linearSq = sleepLinearVelocity * sleepLinearVelocity;
+        const float angularSq = sleepAngularVelocity * sleepAngularVelocity;
+        for (int i = 0; i < n; ++i) {
+            Object* obj = objects[i];
+            if (!isActive(obj)) continue;
+            bool slow = glm::length2(obj->velocity) < linearSq && glm::length2(obj->angularVelocity) < angularSq;
+            obj->sleepCounter = slow ? std::min(obj->sleepCounter + 1, sleepSteps) : 0;
+            int root = islandParent[i];
+            groupSleepCounter[root] = std::min(groupSleepCounter[root], obj->sleepCounter);
+        }
+
+        for (int i = 0; i < n; ++i) {
+            Object* obj = objects[i];
+            if (!isActive(obj) || groupSleepCounter[islandParent[i]] < sleepSteps) continue;
+            obj->sleeping = true;
+            obj->velocity = glm::vec3(0.0f);
+            obj->angularVelocity = glm::vec3(0.0f);
+            obj->linearMomentum = glm::vec3(0.0f);
+            sleepGroup[i] = islandParent[i];
+        }
+    }
+
+    sleepingCount = awakeCount = 0;
+    for (const Object* obj : objects) {
+        if (obj->fixedObject) continue;
+        if (obj->sleeping) sleepingCount++;
+        else awakeCount++;
+    }
+}
+
+// [Snapshot] Layout of a SolverState: a SavedHeader, bodyCount SavedBody records, then cacheCount
+// SavedContact records. Records are copied in and out with memcpy, so the buffer needs no alignment.
+static const unsigned stateMagic = 0x50485953;  // "PHYS"
+
+struct SavedHeader {
+    unsigned magic;
+    int bodyCount, cacheCount;
+    int iterationsUsed;
+    long long stepCount;
+};
+
+struct SavedBody {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 velocity, angularVelocity;
+    glm::vec3 linearMomentum, angularMomentum;
+    glm::mat3 inverseInertiaTensorWorld;
+    int sleepCounter;
+    int sleepGroup;
+    int sleeping, fixed;    // Not bool, so that no padding byte is left uninitialized
+};
+
+// CachedContact with body indices instead of pointers (-1 for the floor and static colliders)
+struct SavedContact {
+    int bodyA, bodyB;
+    int collider;
+    int feature;
+    glm::vec3 localPointA;
+    float impulseNormal;
+    glm::vec3 frictionImpulse;
+};
+
+// Compares the body pairs of two records
+static int savedPairOrder(const SavedContact& x, const SavedContact& y) {
+    if (x.bodyA != y.bodyA) return x.bodyA < y.bodyA ? -1 : 1;
+    if (x.bodyB != y.bodyB) return x.bodyB < y.bodyB ? -1 : 1;
+    return 0;
+}
+
+static_assert(std::is_trivially_copyable<SavedBody>::value && std::is_trivially_copyable<SavedContact>::value,
+              "solver state records are copied with memcpy");
+
+void RigidSolver::saveState(SolverState& state) const {
+    SavedHeader header = {stateMagic, (int)objects.size(), (int)contactCache.size(), iterationsUsed, stepCount};
+    state.data.resize(sizeof(SavedHeader) + header.bodyCount * sizeof(SavedBody) + header.cacheCount * sizeof(SavedContact));
+    unsigned char* out = state.data.data();
+    std::memcpy(out, &header, sizeof(SavedHeader));
+    out += sizeof(SavedHeader);
+
+    // Sleep labels may still name slots from before a removal; each group is saved under the index
+    // of its first body instead, which is always below the body count
+    std::vector<int> groupLabel(wakeGroups.size(), -1);    // wakeGroups covers every label handed out
+    for (int i = 0; i < header.bodyCount; ++i, out += sizeof(SavedBody)) {
+        const Object* obj = objects[i];
+        int group = (i < (int)sleepGroup.size()) ? sleepGroup[i] : -1;
+        if (group >= 0) {
+            if (groupLabel[group] < 0) groupLabel[group] = i;
+            group = groupLabel[group];
+        }
+        SavedBody body = {obj->position, obj->orientation, obj->velocity, obj->angularVelocity,
+                          obj->linearMomentum, obj->angularMomentum, obj->inverseInertiaTensorWorld,
+                          obj->sleepCounter, group, (int)obj->sleeping, (int)obj->fixedObject};
+        std::memcpy(out, &body, sizeof(SavedBody));
+    }
+
+    unsigned char* cacheData = out;
+    bool indexOrder = true;
+    SavedContact previous = {};
+    previous.bodyA = previous.bodyB = -2;
+    for (int k = 0; k < header.cacheCount; ++k, out += sizeof(SavedContact)) {
+        const CachedContact& c = contactCache[k];
+        SavedContact contact = {c.objA->bodyIndex, c.objB ? c.objB->bodyIndex : -1, c.collider, c.feature,
+                                c.localPointA, c.impulseNormal, c.frictionImpulse};
+        std::memcpy(out, &contact, sizeof(SavedContact));
+        indexOrder = indexOrder && savedPairOrder(previous, contact) <= 0;
+        previous = contact;
+    }
+
+    // The cache is in object address order, usually that of the indices. When it is not, the records
+    // are reordered so that equal states always give equal bytes.
+    if (!indexOrder) {
+        std::vector<SavedContact> contacts(header.cacheCount);
+        std::memcpy(contacts.data(), cacheData, header.cacheCount * sizeof(SavedContact));
+        std::stable_sort(contacts.begin(), contacts.end(), [](const SavedContact& x, const SavedContact& y) {
+            return savedPairOrder(x, y) < 0;
+        });
+        std::memcpy(cacheData, contacts.data(), header.cacheCount * sizeof(SavedContact));
+    }
+}
+
+bool RigidSolver::restoreState(const SolverState& state) {
+    SavedHeader header;
+    if (state.size() < sizeof(SavedHeader)) return false;
+    std::memcpy(&header, state.bytes(), sizeof(SavedHeader));
+    if (header.magic != stateMagic || header.bodyCount != (int)objects.size() || header.cacheCount < 0) return false;
+    if (state.size() != sizeof(SavedHeader) + header.bodyCount * sizeof(SavedBody) + header.cacheCount * sizeof(SavedContact)) return false;
+
+    const unsigned char* bodyData = state.bytes() + sizeof(SavedHeader);
+    const unsigned char* cacheData = bodyData + header.bodyCount * sizeof(SavedBody);
+
+    // Everything is checked before anything is written
+    for (int i = 0; i < header.bodyCount; ++i) {
+        SavedBody body;
+        std::memcpy(&body, bodyData + i * sizeof(SavedBody), sizeof(SavedBody));
+        if ((body.fixed != 0) != objects[i]->fixedObject) return false;
+        // Sleep labels index wakeGroups, and a body sleeps exactly when it has one
+        if (body.sleepGroup < -1 || body.sleepGroup >= header.bodyCount) return false;
+        if ((body.sleeping != 0) != (body.sleepGroup >= 0)) return false;
+    }
+    for (int k = 0; k < header.cacheCount; ++k) {
+        SavedContact contact;
+        std::memcpy(&contact, cacheData + k * sizeof(SavedContact), sizeof(SavedContact));
+        if (contact.bodyA < 0 || contact.bodyA >= header.bodyCount || contact.bodyB < -1 || contact.bodyB >= header.bodyCount) return false;
+    }
+
+    sleepGroup.assign(objects.size(), -1);
+    wakeGroups.assign(objects.size(), 0);
+    for (int i = 0; i < header.bodyCount; ++i) {
+        SavedBody body;
+        std::memcpy(&body, bodyData + i * sizeof(SavedBody), sizeof(SavedBody));
+        Object* obj = objects[i];
+        // Restoring is a teleport: nothing to interpolate from
+        obj->position = obj->previousPosition = body.position;
+        obj->orientation = obj->previousOrientation = body.orientation;
+        obj->velocity = body.velocity;
+        obj->angularVelocity = body.angularVelocity;
+        obj->linearMomentum = body.linearMomentum;
+        obj->angularMomentum = body.angularMomentum;
+        obj->inverseInertiaTensorWorld = body.inverseInertiaTensorWorld;
+        obj->sleepCounter = body.sleepCounter;
+        obj->sleeping = body.sleeping != 0;
+        sleepGroup[i] = body.sleepGroup;
+    }
+
+    // The cache is ordered by object address, which differs from the saving solver's when restoring
+    // into other objects; a stable sort keeps the saved order within each pair
+    contactCache.resize(header.cacheCount);
+    for (int k = 0; k < header.cacheCount; ++k) {
+        SavedContact contact;
+        std::memcpy(&contact, cacheData + k * sizeof(SavedContact), sizeof(SavedContact));
+        CachedContact& c = contactCache[k];
+        c.objA = objects[contact.bodyA];
+        c.objB = contact.bodyB >= 0 ? objects[contact.bodyB] : nullptr;
+        c.collider = contact.collider;
+        c.feature = contact.feature;
+        c.localPointA = contact.localPointA;
+        c.impulseNormal = contact.impulseNormal;
+        c.frictionImpulse = contact.frictionImpulse;
+    }
+    std::stable_sort(contactCache.begin(), contactCache.end(), cacheLess);
+
+    // Last step's contacts belong to the replaced state
+    constraints.clear();
+    rows.clear();
+    sleepingCount = awakeCount = 0;
+    for (const Object* obj : objects) {
+        if (obj->fixedObject) continue;
+        if (obj->sleeping) sleepingCount++;
+        else awakeCount++;
+    }
+    iterationsUsed = header.iterationsUsed;
+    stepCount = header.stepCount;
+    return true;
+}
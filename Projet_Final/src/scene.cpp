@@ -1,7 +1,10 @@
 #include "scene.h"
 #include "window.h"
+#include "physicsthread.h"
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <iostream>
+#include <omp.h>
 
 // --- Base Scene Implementation ---
 
@@ -22,19 +25,75 @@ Scene::~Scene()
 void Scene::step(float dt)
 {
     solver.step(dt);
+    cullObjects(dt);
 }
 
 void Scene::addObject(Object *obj)
 {
+    obj->sceneIndex = (int)objects.size();
     objects.push_back(obj);
     solver.addObject(obj);
 }
 
+void Scene::addStaticObject(Object *obj)
+{
+    obj->sceneIndex = (int)objects.size();
+    objects.push_back(obj);
+    solver.addStaticMesh(*obj->mesh, obj->getModelMatrix());
+}
+
+Object *Scene::acquireObject(Mesh *mesh, Material *material)
+{
+    Object *obj = pool.acquire(mesh, material);
+    obj->lifetime = maxLifetime;
+    return obj;
+}
+
+void Scene::removeObject(Object *obj)
+{
+    // Objects pushed straight into the list have no slot and are searched for
+    int i = obj->sceneIndex;
+    if (i < 0 || i >= (int)objects.size() || objects[i] != obj)
+        i = (int)(std::find(objects.begin(), objects.end(), obj) - objects.begin());
+    if (i == (int)objects.size()) return;
+
+    // [Swap-remove] The last object takes the freed slot
+    objects[i] = objects.back();
+    if (objects[i]->sceneIndex >= 0) objects[i]->sceneIndex = i;
+    objects.pop_back();
+    obj->sceneIndex = -1;
+    solver.removeObject(obj);
+}
+
+// Bodies out of the kill volume or past their lifetime go back to the pool
+void Scene::cullObjects(float dt)
+{
+    for (int i = (int)objects.size() - 1; i >= 0; --i)
+    {
+        Object *obj = objects[i];
+        if (obj->bodyIndex < 0 || obj->fixedObject) continue;
+        bool expired = false;
+        if (obj->lifetime >= 0.0f)
+        {
+            obj->lifetime -= dt;
+            expired = obj->lifetime <= 0.0f;
+        }
+        glm::vec3 p = obj->position;
+        bool outside = glm::any(glm::lessThan(p, killVolume.min)) || glm::any(glm::greaterThan(p, killVolume.max));
+        if (!expired && !outside) continue;
+        removeObject(obj);
+        pool.release(obj);
+    }
+}
+
 
 void Scene::processInput(GLFWwindow *window, const glm::vec3 &cameraPos, const glm::mat4 &view, const glm::mat4 &projection) {}
 
 // --- PhysicsStackScene Implementation ---
 
+// [Snapshot] Solver state of the stack once it has come to rest, kept for the rest of the run
+static SolverState settledStack;
+
 PhysicsStackScene::PhysicsStackScene()
 {
     // Create assets needed for this specific scene
@@ -101,6 +160,20 @@ PhysicsStackScene::PhysicsStackScene()
     ground->mass = 0.0f;
     ground->collisionRadius = 0.0f;
     this->objects.push_back(ground);
+
+    // Settle the stack until it falls asleep the first time the scene is built; later visits
+    // restore that state instead of simulating the settling again
+    if (settledStack.empty() || !solver.restoreState(settledStack))
+    {
+        const int maxSettleSteps = 600;
+        for (int i = 0; i < maxSettleSteps; ++i)
+        {
+            solver.step(PhysicsThread::defaultTimeStep);
+            if (solver.getAwakeCount() == 0)
+                break;
+        }
+        solver.saveState(settledStack);
+    }
 }
 
 PhysicsStackScene::~PhysicsStackScene()
@@ -135,6 +208,153 @@ PhysicsStackScene::~PhysicsStackScene()
     }
 }
 
+// --- SolverStressScene Implementation ---
+
+SolverStressScene::SolverStressScene()
+{
+    boxMesh = new Mesh({}, {});
+    boxMesh->addCube(1.0f);
+    boxMesh->subdivideLinear();
+
+    std::vector<glm::vec3> colors = {
+        glm::vec3(0.937f, 0.325f, 0.314f),
+        glm::vec3(0.937f, 0.933f, 0.345f),
+        glm::vec3(0.259f, 0.647f, 0.960f)
+    };
+    for (const auto& color : colors) {
+        Material* m = new Material();
+        m->diffuse = color;
+        boxMaterials.push_back(m);
+    }
+
+    groundMesh = new Mesh({}, {});
+    groundMesh->addPlan(15.0f);
+    groundMaterial = new Material();
+    groundMaterial->diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+
+    // Square pyramid: every box rests on four below it, so the whole pile is one island
+    float groundLevel = -2.0f;
+    int base = 10;
+    for (int y = 0; y < base; ++y)
+    {
+        int side = base - y;
+        for (int x = 0; x < side; ++x)
+        {
+            for (int z = 0; z < side; ++z)
+            {
+                Object *box = new Object(boxMesh, boxMaterials[y % boxMaterials.size()]);
+                box->setPosition(glm::vec3(
+                    x - (side - 1) * 0.5f,
+                    groundLevel + 0.5f + y * 1.0f,
+                    z - (side - 1) * 0.5f));
+                box->setAsBox(1.0f, 1.0f, 1.0f, 1.0f);
+                box->restitution = 0.0f;
+                this->addObject(box);
+            }
+        }
+    }
+
+    solver.parallelSolve = ParallelSolve::GraphColoring;
+
+    Object *ground = new Object(groundMesh, groundMaterial);
+    ground->setPosition(glm::vec3(0.0f, groundLevel, 0.0f));
+    ground->fixedObject = true;
+    ground->mass = 0.0f;
+    this->objects.push_back(ground);
+}
+
+SolverStressScene::~SolverStressScene()
+{
+    if (boxMesh) { boxMesh->cleanup(); delete boxMesh; }
+    for (auto m : boxMaterials) delete m;
+    if (groundMesh) { groundMesh->cleanup(); delete groundMesh; }
+    if (groundMaterial) delete groundMaterial;
+}
+
+void SolverStressScene::processInput(GLFWwindow *window, const glm::vec3 &cameraPos, const glm::mat4 &view, const glm::mat4 &projection)
+{
+    static bool mPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+    {
+        if (!mPressed)
+        {
+            measureSpeedup();
+            mPressed = true;
+        }
+    }
+    else
+    {
+        mPressed = false;
+    }
+}
+
+void SolverStressScene::measureSpeedup()
+{
+    // The scene is put back as it was once the measurement is over
+    SolverState sceneState;
+    solver.saveState(sceneState);
+
+    // The step the physics thread runs, so the timings match the app's load
+    const int steps = 200;
+    const float dt = PhysicsThread::defaultTimeStep;
+    // Every run starts from the same state, warm-start cache included
+    SolverState runState;
+    auto timeSteps = [&]() {
+        solver.restoreState(runState);
+        double start = omp_get_wtime();
+        for (int i = 0; i < steps; ++i) solver.step(dt);
+        return (omp_get_wtime() - start) * 1000.0 / steps;
+    };
+
+    int defaultThreads = omp_get_max_threads();
+    int cores = omp_get_num_procs();
+    ParallelSolve mode = solver.parallelSolve;
+    SolverMode solverMode = solver.solverMode;
+    solver.solverMode = SolverMode::PGS;
+
+    // The pyramid must keep being solved for the whole measurement
+    bool allowSleeping = solver.allowSleeping;
+    solver.allowSleeping = false;
+    solver.wakeAll();
+    solver.saveState(runState);
+
+    omp_set_num_threads(1);
+    solver.parallelSolve = ParallelSolve::Serial;
+    double serialMs = timeSteps();
+    std::cout << "Solver stress (" << objects.size() - 1 << " boxes, " << steps << " steps)" << std::endl;
+    std::cout << "  serial PGS, 1 thread: " << serialMs << " ms/step" << std::endl;
+
+    // Powers of two up to the core count, then the core count itself
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    solver.parallelSolve = ParallelSolve::GraphColoring;
+    for (int threads : threadCounts)
+    {
+        omp_set_num_threads(threads);
+        double ms = timeSteps();
+        std::cout << "  graph coloring, " << threads << " thread(s): " << ms << " ms/step, speedup x" << serialMs / ms << std::endl;
+    }
+
+    // Single-threaded cost of one PGS row visit on the last step's contacts
+    std::cout << "  PGS row visit: " << solver.measureSolveCost(50) << " ns" << std::endl;
+
+    // Same pyramid with TGS sub-stepping, at all cores
+    omp_set_num_threads(cores);
+    double pgsMs = timeSteps();
+    solver.solverMode = SolverMode::TGS;
+    double tgsMs = timeSteps();
+    std::cout << "  PGS (" << solver.iterations << " iterations): " << pgsMs << " ms/step, TGS (" << solver.subSteps
+              << " sub-steps): " << tgsMs << " ms/step" << std::endl;
+    solver.solverMode = solverMode;
+
+    omp_set_num_threads(defaultThreads);
+    solver.parallelSolve = mode;
+    solver.allowSleeping = allowSleeping;
+    solver.restoreState(sceneState);
+}
+
 // --- RayTracingScene Implementation ---
 
 RayTracingScene::RayTracingScene()
@@ -171,7 +391,7 @@ RayTracingScene::RayTracingScene()
     mirrorWall->setRotation(glm::vec3(0, 0, 90));
     mirrorWall->setScale(glm::vec3(mirrorHeight / 40.0f, 1.0f, 1.0f)); // Scale Y-axis (local X because of rot)
     mirrorWall->fixedObject = true;
-    this->addObject(mirrorWall);
+    this->addStaticObject(mirrorWall);
 
     // Frame for the mirror (4 beams)
     Mesh *frameBox = new Mesh({}, {});
@@ -323,7 +543,7 @@ void PhysicsStackScene::processInput(GLFWwindow *window, const glm::vec3 &camera
     {
         if (!leftMousePressed)
         {
-            Object *bolt = new Object(this->SphereMesh, this->SphereMaterial);
+            Object *bolt = acquireObject(this->SphereMesh, this->SphereMaterial);
             bolt->setPosition(cameraPos);
             bolt->setScale(glm::vec3(0.5f));
             bolt->setAsSphere(0.5f, 2.0f);      
@@ -345,7 +565,7 @@ void PhysicsStackScene::processInput(GLFWwindow *window, const glm::vec3 &camera
             glm::vec3 spawnPos = glm::vec3(0.0f, 15.0f, 0.0f);
 
             // Create Large Sphere
-            Object *bigSphere = new Object(SphereMesh, SphereMaterial);
+            Object *bigSphere = acquireObject(SphereMesh, SphereMaterial);
             bigSphere->setPosition(spawnPos);
             bigSphere->setScale(glm::vec3(3.0f));  
             bigSphere->setAsSphere(3.0f, 10.0f);  
@@ -386,48 +606,48 @@ MirrorScene::MirrorScene()
     rightMirrorMat->reflectivity = 0.9f;                    // 90% Sharp reflection, 10% Diffuse
     rightMirrorMat->roughness = 0.0f;
 
-    // --- Create 6 walls using addObject for consistency ---
+    // --- Create 6 walls, colliding as static meshes ---
 
     // Floor (Normal +Y)
     Object *floor = new Object(planeMesh, mirrorMat);
     floor->setPosition(glm::vec3(0, -halfSize + elevation, 0));
     floor->fixedObject = true;
-    this->addObject(floor);
+    this->addStaticObject(floor);
 
     // Ceiling (Normal -Y)
     Object *ceiling = new Object(planeMesh, mirrorMat);
     ceiling->setPosition(glm::vec3(0, halfSize + elevation, 0));
     ceiling->setRotation(glm::vec3(180, 0, 0));
     ceiling->fixedObject = true;
-    this->addObject(ceiling);
+    this->addStaticObject(ceiling);
 
     // Back Wall (Normal +Z - facing camera)
     Object *backWall = new Object(planeMesh, mirrorMat);
     backWall->setPosition(glm::vec3(0, elevation, -halfSize));
     backWall->setRotation(glm::vec3(90, 0, 0));
     backWall->fixedObject = true;
-    this->addObject(backWall);
+    this->addStaticObject(backWall);
 
     // Front Wall (Normal -Z - behind camera)
     Object *frontWall = new Object(planeMesh, mirrorMat);
     frontWall->setPosition(glm::vec3(0, elevation, halfSize));
     frontWall->setRotation(glm::vec3(-90, 0, 0));
     frontWall->fixedObject = true;
-    this->addObject(frontWall);
+    this->addStaticObject(frontWall);
 
     // Left Wall (Position -X, needs Normal +X to face center)
     Object *leftWall = new Object(planeMesh, leftMirrorMat);
     leftWall->setPosition(glm::vec3(-halfSize, elevation, 0));
     leftWall->setRotation(glm::vec3(0, 0, -90)); 
     leftWall->fixedObject = true;
-    this->addObject(leftWall);
+    this->addStaticObject(leftWall);
 
     // Right Wall (Position +X, needs Normal -X to face center)
     Object *rightWall = new Object(planeMesh, rightMirrorMat);
     rightWall->setPosition(glm::vec3(halfSize, elevation, 0));
     rightWall->setRotation(glm::vec3(0, 0, 90)); 
     rightWall->fixedObject = true;
-    this->addObject(rightWall);
+    this->addStaticObject(rightWall);
 
     // --- Ceiling Light ---
     lightMesh = new Mesh({}, {});
@@ -511,7 +731,7 @@ DarkScene::DarkScene()
     Object *floor = new Object(planeMesh, floorMat);
     floor->setPosition(glm::vec3(0, -2.0f, 0));
     floor->fixedObject = true;
-    this->addObject(floor);
+    this->addStaticObject(floor);
 
     // --- Red Light Path (Mirror Bounce) ---
     // Mirror for the red light (on the left)
@@ -523,7 +743,7 @@ DarkScene::DarkScene()
     redMirror->setRotation(glm::vec3(0, 0, -45)); // Reflects upwards light towards the origin
     redMirror->setScale(glm::vec3(0.1f)); 
     redMirror->fixedObject = true;
-    this->addObject(redMirror);
+    this->addStaticObject(redMirror);
 
     // Red Light (above the mirror)
     redLightMat = new Material();
@@ -656,6 +876,37 @@ SeaScene::SeaScene()
     seaBottomObject->fixedObject = false;
     this->objects.push_back(seaBottomObject);
 
+    // --- Sea surface collider: reads the heights SeaScene::step writes into the mesh ---
+    solver.floorY = -50.0f;
+    solver.addHeightfield(HeightfieldCollider(&seaMesh->vertices[0].position.y, sizeof(Vertex) / sizeof(float),
+                                              gridRes, gridRes, glm::vec2(-seaSize / 2.0f), stepSize));
+
+    // --- Crates and buoys dropped on the waves ---
+    crateMesh = new Mesh({}, {});
+    crateMesh->addCube(1.0f);
+    buoyMesh = Icosahedron::createIcosphere(1.0f, 2);
+    driftMat = new Material();
+    driftMat->diffuse = glm::vec3(0.8f, 0.35f, 0.1f);
+    driftMat->roughness = 0.6f;
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 position((i % 4) * 4.0f - 6.0f, 2.0f + i, (i / 4) * 5.0f - 12.0f);
+        Object *drift = new Object(i % 2 ? buoyMesh : crateMesh, driftMat);
+        drift->setPosition(position);
+        if (i % 2)
+        {
+            drift->setScale(glm::vec3(0.6f));
+            drift->setAsSphere(0.6f, 1.0f);
+            drift->restitution = 0.4f;
+        }
+        else
+        {
+            drift->setAsBox(1.0f, 1.0f, 1.0f, 1.0f);
+            drift->setRotation(glm::vec3(0.0f, 30.0f * i, 15.0f));
+        }
+        this->addObject(drift);
+    }
+
     // --- Rising Sun ---
     sunMesh = Icosahedron::createIcosphere(1.0f, 2);
     sunMat = new Material();
@@ -677,6 +928,9 @@ SeaScene::~SeaScene()
     if (seaBottomMat) delete seaBottomMat;
     if (sunMesh) { sunMesh->cleanup(); delete sunMesh; }
     if (sunMat) delete sunMat;
+    if (crateMesh) { crateMesh->cleanup(); delete crateMesh; }
+    if (buoyMesh) { buoyMesh->cleanup(); delete buoyMesh; }
+    if (driftMat) delete driftMat;
 }
 
 void SeaScene::step(float dt)
@@ -700,7 +954,7 @@ void SeaScene::step(float dt)
     
 
     seaMesh->recomputeNormals();
-    seaMesh->updateBuffers();
+    seaMeshDirty = true;
 
 
     seaBottomObject->setPosition(glm::vec3(0.0f, -0.2f, 0.0f)); 
@@ -713,4 +967,12 @@ void SeaScene::step(float dt)
     Scene::step(dt);
 }
 
+// Steps may run on the physics thread, away from the GL context
+void SeaScene::prepareRender()
+{
+    if (!seaMeshDirty) return;
+    seaMesh->updateBuffers();
+    seaMeshDirty = false;
+}
+
 void SeaScene::processInput(GLFWwindow *window, const glm::vec3 &cameraPos, const glm::mat4 &view, const glm::mat4 &projection) {}
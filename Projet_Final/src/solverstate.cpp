@@ -0,0 +1,25 @@
+#include "solverstate.h"
+#include <cstdio>
+
+bool SolverState::writeFile(const std::string& path) const {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (std::fclose(file) == 0) && written;
+}
+
+bool SolverState::readFile(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::fseek(file, 0, SEEK_END);
+    long length = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    bool read = length >= 0;
+    if (read) {
+        data.resize((size_t)length);
+        read = std::fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    std::fclose(file);
+    if (!read) data.clear();
+    return read;
+}
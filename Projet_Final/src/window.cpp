@@ -101,6 +101,87 @@ void Window::processInput(Scene &currentScene, float deltaTime)
         pPressed = false;
     }
 
+    // Switch the physics broad phase to compare timings in the title bar
+    static bool bPressed = false;
+    if (glfwGetKey(ptr, GLFW_KEY_B) == GLFW_PRESS)
+    {
+        if (!bPressed)
+        {
+            RigidSolver &solver = currentScene.solver;
+            if (solver.broadPhase == BroadPhaseMode::SpatialHash)
+            {
+                solver.broadPhase = BroadPhaseMode::AABBTree;
+                std::cout << "Broad phase: dynamic AABB tree" << std::endl;
+            }
+            else if (solver.broadPhase == BroadPhaseMode::AABBTree)
+            {
+                solver.broadPhase = BroadPhaseMode::SweepAndPrune;
+                std::cout << "Broad phase: sweep and prune" << std::endl;
+            }
+            else if (solver.broadPhase == BroadPhaseMode::SweepAndPrune)
+            {
+                solver.broadPhase = BroadPhaseMode::BruteForce;
+                std::cout << "Broad phase: brute force" << std::endl;
+            }
+            else
+            {
+                solver.broadPhase = BroadPhaseMode::SpatialHash;
+                std::cout << "Broad phase: spatial hash" << std::endl;
+            }
+            bPressed = true;
+        }
+    }
+    else
+    {
+        bPressed = false;
+    }
+
+    // Switch between the PGS solver and TGS sub-stepping
+    static bool vPressed = false;
+    if (glfwGetKey(ptr, GLFW_KEY_V) == GLFW_PRESS)
+    {
+        if (!vPressed)
+        {
+            RigidSolver &solver = currentScene.solver;
+            if (solver.solverMode == SolverMode::PGS)
+            {
+                solver.solverMode = SolverMode::TGS;
+                std::cout << "Solver: TGS, " << solver.subSteps << " sub-steps" << std::endl;
+            }
+            else
+            {
+                solver.solverMode = SolverMode::PGS;
+                std::cout << "Solver: PGS, " << solver.iterations << " iterations" << std::endl;
+            }
+            vPressed = true;
+        }
+    }
+    else
+    {
+        vPressed = false;
+    }
+
+    // Dump the solver's step history (PHYSICS_PROFILING builds only)
+    static bool cPressed = false;
+    if (glfwGetKey(ptr, GLFW_KEY_C) == GLFW_PRESS)
+    {
+        if (!cPressed)
+        {
+            const PhysicsProfiler &profiler = currentScene.solver.getProfiler();
+            if (profiler.size() == 0)
+                std::cout << "No physics profile: build with -DPHYSICS_PROFILING=ON" << std::endl;
+            else if (profiler.writeCSV("physics_profile.csv"))
+                std::cout << "Physics profile: " << profiler.size() << " steps written to physics_profile.csv" << std::endl;
+            else
+                std::cout << "Failed to write physics_profile.csv" << std::endl;
+            cPressed = true;
+        }
+    }
+    else
+    {
+        cPressed = false;
+    }
+
     // Camera movement
     float speed = movementSpeed * deltaTime;
     glm::vec3 front_horizontal = glm::normalize(glm::vec3(cameraFront.x, 0.0f, cameraFront.z));